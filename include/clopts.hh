@@ -3,17 +3,26 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <bitset>
 #include <cerrno>
+#include <charconv>
 #include <cstring>
 #include <filesystem>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
+#include <ranges>
 #include <span>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #ifndef CLOPTS_USE_MMAP
@@ -33,6 +42,53 @@
 #    include <fstream>
 #endif
 
+#ifndef CLOPTS_USE_IO_URING
+#    define CLOPTS_USE_IO_URING 0
+#endif
+
+#if CLOPTS_USE_IO_URING
+#    if !CLOPTS_USE_MMAP or !defined(__linux__)
+#        error "CLOPTS_USE_IO_URING is only supported on Linux"
+#    endif
+#    include <linux/io_uring.h>
+#    include <sys/syscall.h>
+#    ifndef CLOPTS_IO_URING_ENTER
+#        define CLOPTS_IO_URING_ENTER(fd, to_submit, min_complete, flags) \
+            ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0)
+#    endif
+#endif
+
+#ifndef CLOPTS_USE_INOTIFY
+#    define CLOPTS_USE_INOTIFY 0
+#endif
+
+#if CLOPTS_USE_INOTIFY
+#    if !CLOPTS_USE_MMAP or !defined(__linux__)
+#        error "CLOPTS_USE_INOTIFY is only supported on Linux"
+#    endif
+#    include <poll.h>
+#    include <sys/eventfd.h>
+#    include <sys/inotify.h>
+#endif
+
+#ifndef CLOPTS_USE_SIMD
+#    if defined(__SSE2__) or defined(_M_X64)
+#        define CLOPTS_USE_SIMD 1
+#    else
+#        define CLOPTS_USE_SIMD 0
+#    endif
+#endif
+
+#if CLOPTS_USE_SIMD
+#    if defined(__AVX2__)
+#        include <immintrin.h>
+#    elif defined(__SSE2__) or defined(_M_X64)
+#        include <emmintrin.h>
+#    else
+#        error "CLOPTS_USE_SIMD requires SSE2"
+#    endif
+#endif
+
 /// \brief Main library namespace.
 ///
 /// The name of this is purposefully verbose to avoid name collisions. Users are
@@ -161,7 +217,7 @@ concept is_same = (std::is_same_v<a, bs> or ...);
 
 /// Check if an operand type is a vector.
 template <typename t> struct test_vector;
-template <typename t> struct test_vector<std::vector<t>> {
+template <typename t, typename alloc> struct test_vector<std::vector<t, alloc>> {
     static constexpr bool value = true;
     using type = t;
 };
@@ -431,10 +487,10 @@ struct values_impl {
     using type = _type;
     constexpr values_impl() = delete;
 
-    static constexpr bool is_valid_option_value(const type& val) {
-        auto test = [val]<auto value>() -> bool {
+    static constexpr bool is_valid_option_value(const auto& val) {
+        auto test = [&]<auto value>() -> bool {
             if constexpr (value.is_integer) return value.integer == val;
-            else return value.s == val;
+            else return value.s == std::string_view{val};
         };
 
         return (test.template operator()<data>() or ...);
@@ -478,16 +534,24 @@ struct ref {
     using type = _type;
 };
 
+/// Like ref<>, but records how many values the referenced options had
+/// instead of copying them.
+template <typename _type, static_string... args>
+struct snapshot_ref : ref<_type, args...> {
+    static constexpr bool is_snapshot = true;
+};
+
 /// Check that an option type is valid.
 template <typename type>
 concept is_valid_option_type = is_same<type, std::string, // clang-format off
+    std::string_view,
     bool,
     double,
     int64_t,
     special_tag,
     callback_arg_type,
     callback_noarg_type
-> or is_vector_v<type> or requires { type::is_values; } or requires { type::is_file_data; };
+> or is_vector_v<type> or requires { type::is_values; } or requires { type::is_file_data; } or requires { type::is_mapped_file; } or requires { type::is_lazy_file; } or requires { type::is_watched_file; } or requires { type::is_stream; } or requires { type::is_lines; } or requires { type::is_output_file; };
 // clang-format on
 
 template <typename _type>
@@ -513,6 +577,9 @@ struct option_type<ref<_type, vs...>> {
     static constexpr bool is_ref = true;
 };
 
+template <typename _type, auto... vs>
+struct option_type<snapshot_ref<_type, vs...>> : option_type<ref<_type, vs...>> {};
+
 template <typename _type>
 using option_type_t = typename option_type<_type>::type;
 
@@ -554,7 +621,7 @@ struct opt_impl {
     static_assert(not std::is_void_v<canonical_type>, "Option type may not be void. Use bool instead");
     static_assert(
         is_valid_option_type<canonical_type>,
-        "Option type must be std::string, bool, int64_t, double, file_data, values<>, or callback"
+        "Option type must be std::string, std::string_view, bool, int64_t, double, file_data, mapped_file<>, lazy_file<>, stream<>, lines<>, values<>, or callback"
     );
 
     static constexpr decltype(_name) name = _name;
@@ -562,14 +629,13 @@ struct opt_impl {
     static constexpr bool is_flag = std::is_same_v<canonical_type, bool>;
     static constexpr bool is_values = is_values_type_t<declared_type_base>;
     static constexpr bool is_ref = option_type<declared_type_base>::is_ref;
+    static constexpr bool is_snapshot_ref = is_ref and requires { declared_type_base::is_snapshot; };
     static constexpr bool is_required = required;
     static constexpr bool is_overridable = overridable;
     static constexpr bool option_tag = true;
     static_assert(not is_flag or not is_ref, "Flags cannot reference other options"); // TODO: Allow this?
 
-    static constexpr bool is_valid_option_value(
-        const single_element_type& val
-    ) {
+    static constexpr bool is_valid_option_value(const auto& val) {
         if constexpr (is_values) return declared_type_base::is_valid_option_value(val);
         else return true;
     }
@@ -591,497 +657,2501 @@ struct opt_impl {
     std::exit(1);
 }
 
-template <typename file_data_type>
-static file_data_type map_file(
-    std::string_view path,
-    auto error_handler = [](std::string&& msg) { std::cerr << msg << "\n"; std::exit(1); }
-) {
-    const auto err = [&](std::string_view p) -> file_data_type {
-        std::string msg = "Could not read file \"";
-        msg += p;
-        msg += "\": ";
-        msg += ::strerror(errno);
-        error_handler(std::move(msg));
-        return {};
-    };
+/// The kinds of errors that can occur while parsing.
+enum class error_kind {
+    unrecognised_option,
+    duplicate_option,
+    missing_argument,
+    missing_required_option,
+    invalid_value,
+    empty_number,
+    invalid_number,
+    number_out_of_range,
+    file_error,
+    file_budget_exceeded,
+    output_file_error,
+    recursive_response_file,
+};
 
-#if CLOPTS_USE_MMAP
-    int fd = ::open(path.data(), O_RDONLY);
-    if (fd < 0) return err(path);
+/// \brief An error that occurred while parsing.
+///
+/// This only refers to the command line and to the option names instead of
+/// copying them, so it is only valid until the error handler returns. The
+/// error message is only formatted if \c message() is called.
+struct parse_error {
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    /// What went wrong.
+    error_kind kind{};
+
+    /// The option the error is about, if any. This is the name of the option
+    /// as it appears in the \c clopts type, except for \c missing_argument and
+    /// \c invalid_value, where it is the option name as it was written on the
+    /// command line.
+    std::string_view option{};
+
+    /// The offending argument or option value, if any.
+    std::string_view argument{};
+
+    /// The type that was expected, if this is an error parsing a number.
+    std::string_view expected{};
+
+    /// The index of the option in the \c clopts type, or \c npos.
+    std::size_t option_index = npos;
+
+    /// The index of the argument in \c argv, or -1.
+    int argument_index = -1;
+
+    /// The value of \c errno, if this is a \c file_error or \c output_file_error.
+    int error_code = 0;
+
+    /// Format the error message.
+    [[nodiscard]] auto message() const -> std::string {
+        auto concat = [](auto... parts) {
+            std::string msg;
+            ((msg += parts), ...);
+            return msg;
+        };
 
-    struct stat s {};
-    if (::fstat(fd, &s)) return err(path);
-    auto sz = size_t(s.st_size);
-    if (sz == 0) return {};
-
-    auto* mem = (char*) ::mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
-    if (mem == MAP_FAILED) return err(path);
-    ::close(fd);
-
-    // Construct the file contents.
-    typename file_data_type::contents_type ret;
-    auto pointer = reinterpret_cast<typename file_data_type::element_pointer>(mem);
-    if constexpr (requires { ret.assign(pointer, sz); }) ret.assign(pointer, sz);
-    else if constexpr (requires { ret.assign(pointer, pointer + sz); }) ret.assign(pointer, pointer + sz);
-    else CLOPTS_ERR("file_data_type::contents_type must have a callable assign member that takes a pointer and a size_t (or a begin and end iterator) as arguments.");
-    ::munmap(mem, sz);
+        switch (kind) {
+            case error_kind::unrecognised_option: return concat("Unrecognized option: \"", argument, "\"");
+            case error_kind::duplicate_option: return concat("Duplicate option: \"", argument, "\"");
+            case error_kind::missing_argument: return concat("Missing argument for option \"", option, "\"");
+            case error_kind::missing_required_option: return concat("Option \"", option, "\" is required");
+            case error_kind::invalid_value: return concat("Invalid value for option '", option, "': '", argument, "'");
+            case error_kind::empty_number: return concat("Expected ", expected, ", got empty string");
+            case error_kind::invalid_number: return concat(argument, " does not appear to be a valid ", expected);
+            case error_kind::number_out_of_range: return concat(argument, " is out of range for type '", expected, "'");
+            case error_kind::file_error: return concat("Could not read file \"", argument, "\": ", ::strerror(error_code));
+            case error_kind::file_budget_exceeded: return concat("Could not read file \"", argument, "\": total size of all files exceeds the limit");
+            case error_kind::output_file_error: return concat("Could not open file \"", argument, "\" for writing: ", ::strerror(error_code));
+            case error_kind::recursive_response_file: return concat("Response file \"", argument, "\" includes itself or is nested too deeply");
+        }
 
-#else
-    using contents_type = typename file_data_type::contents_type;
+        return "Unknown error";
+    }
+};
+
+/// \brief Call an error handler.
+///
+/// Error handlers either take the formatted message as a \c std::string&&, or
+/// the \c parse_error itself. Handlers that accept both get the message, since
+/// that is what error handlers used to take.
+template <typename callable>
+bool invoke_error_handler(callable& handler, const parse_error& error) {
+    if constexpr (std::is_invocable_r_v<bool, callable&, std::string&&>) return handler(error.message());
+    else if constexpr (std::is_invocable_r_v<bool, callable&, const parse_error&>) return handler(error);
+    else static_assert(always_false<callable>, "Error handler must be callable with a std::string&& or a const parse_error& and return bool");
+}
 
-    // Read the file manually.
-    std::unique_ptr<FILE, decltype(&std::fclose)> f{std::fopen(path.data(), "rb"), std::fclose};
-    if (not f) return err(path);
+/// Check whether an error handler is \c nullptr or an empty \c std::function.
+template <typename callable>
+constexpr bool is_null_error_handler(const callable& handler) {
+    if constexpr (std::is_pointer_v<callable> or requires { handler.target_type(); }) return not handler;
+    else return false;
+}
 
-    // Get the file size.
-    std::fseek(f.get(), 0, SEEK_END);
-    auto sz = std::size_t(std::ftell(f.get()));
-    std::fseek(f.get(), 0, SEEK_SET);
+/// \brief Non-owning reference to an error handler.
+///
+/// This is two pointers wide and never allocates; the handler must outlive it.
+class error_handler_ref {
+    union target_type {
+        void* object;
+        void (*function)();
+    };
 
-    // Read the file.
-    contents_type ret;
-    ret.resize(sz);
-    std::size_t n_read = 0;
-    while (n_read < sz) {
-        auto n = std::fread(ret.data() + n_read, 1, sz - n_read, f.get());
-        if (n < 0) return err(path);
-        if (n == 0) break;
-        n_read += n;
+    target_type target{};
+    bool (*thunk)(target_type, const parse_error&){};
+
+public:
+    error_handler_ref() = default;
+
+    /// Refer to a callable object or function.
+    template <typename callable>
+    requires (not std::is_same_v<std::remove_cvref_t<callable>, error_handler_ref>)
+    explicit error_handler_ref(callable&& handler) {
+        using type = std::remove_reference_t<callable>;
+        if constexpr (std::is_function_v<type>) {
+            target.function = reinterpret_cast<void (*)()>(&handler);
+            thunk = [](target_type t, const parse_error& e) {
+                return invoke_error_handler(*reinterpret_cast<type*>(t.function), e);
+            };
+        } else {
+            target.object = const_cast<void*>(static_cast<const void*>(std::addressof(handler)));
+            thunk = [](target_type t, const parse_error& e) {
+                return invoke_error_handler(*static_cast<type*>(t.object), e);
+            };
+        }
     }
-#endif
 
-    // Construct the file data.
-    file_data_type dat;
-    dat.path = typename file_data_type::path_type{path.begin(), path.end()};
-    dat.contents = std::move(ret);
-    return dat;
+    /// Check whether this refers to a handler.
+    explicit operator bool() const { return thunk != nullptr; }
+
+    /// Invoke the handler.
+    bool operator()(const parse_error& error) const { return thunk(target, error); }
+};
+
+/// Assign a range of bytes to the contents of a file<>.
+template <typename contents_type>
+void assign_contents(contents_type& contents, const void* data, std::size_t size) {
+    auto pointer = static_cast<const typename contents_type::value_type*>(data);
+    if constexpr (requires { contents.assign(pointer, size); }) contents.assign(pointer, size);
+    else if constexpr (requires { contents.assign(pointer, pointer + size); }) contents.assign(pointer, pointer + size);
+    else CLOPTS_ERR("file_data_type::contents_type must have a callable assign member that takes a pointer and a size_t (or a begin and end iterator) as arguments.");
 }
 
-/// Get the name of an option type.
-template <typename t>
-static consteval auto type_name() -> static_string<25> {
-    static_string<25> buffer;
-    if constexpr (detail::is<t, std::string>) buffer.append("string");
-    else if constexpr (detail::is<t, bool>) buffer.append("bool");
-    else if constexpr (detail::is<t, std::int64_t, double>) buffer.append("number");
-    else if constexpr (requires { t::is_file_data; }) buffer.append("file");
-    else if constexpr (detail::is_callback<t>) buffer.append("arg");
-    else if constexpr (detail::is_vector_v<t>) {
-        buffer.append(type_name<typename t::value_type>().arr, type_name<typename t::value_type>().len);
-        buffer.append("s");
+/// \brief Read data whose size we don’t know in advance, e.g. from a pipe, into the contents of a file<>.
+///
+/// \param read_some Reads up to a number of bytes into a buffer and returns how
+///        many it read, 0 at the end of the file, or -1 on error.
+/// \param limit The maximum number of bytes to read.
+/// \param truncate If there is more data than \p limit, keep the first \p limit
+///        bytes instead of failing with \c EFBIG.
+/// \return 0 on success, or the value of \c errno on error.
+template <typename contents_type>
+int read_until_eof(
+    contents_type& contents,
+    auto read_some,
+    std::size_t limit = std::numeric_limits<std::size_t>::max(),
+    bool truncate = false
+) {
+    // Unless we’re truncating, read one byte more than the limit to find out if there is more.
+    auto max = truncate or limit == std::numeric_limits<std::size_t>::max() ? limit : limit + 1;
+    auto read_into = [&](auto& buffer) {
+        std::size_t size = 0;
+        for (std::size_t capacity = std::min<std::size_t>(64 << 10, max);; capacity = std::min(capacity * 2, max)) {
+            buffer.resize(capacity);
+            while (size < capacity) {
+                auto n = read_some(reinterpret_cast<char*>(buffer.data()) + size, capacity - size);
+                if (n <= 0) {
+                    int error = n < 0 ? errno : 0;
+                    buffer.resize(size);
+                    return error;
+                }
+
+                size += std::size_t(n);
+            }
+
+            if (size == max) {
+                buffer.resize(std::min(size, limit));
+                return size > limit ? EFBIG : 0;
+            }
+        }
+    };
+
+    // Read directly into the contents if we can.
+    if constexpr (sizeof(typename contents_type::value_type) == 1 and requires { contents.resize(std::size_t{}); contents.data(); }) {
+        return read_into(contents);
     } else {
-        CLOPTS_ERR("Option type must be std::string, bool, integer, double, or void(*)(), or a vector thereof");
+        std::string buffer;
+        int error = read_into(buffer);
+        assign_contents(contents, buffer.data(), buffer.size());
+        return error;
     }
-    return buffer;
 }
 
-// ===========================================================================
-//  Sort/filter helpers.
-// ===========================================================================
-template <typename opt>
-struct get_option_name {
-    static constexpr std::string_view value = opt::name.sv();
-};
+#if CLOPTS_USE_MMAP
+/// \brief Read up to \p size bytes from a file descriptor, retrying if we’re interrupted.
+///
+/// \return The number of bytes read, 0 at the end of the file, or -1 on error.
+inline auto read_some(int fd, void* buffer, std::size_t size) -> std::int64_t {
+    for (;;) {
+        auto n = ::read(fd, buffer, size);
+        if (n < 0 and errno == EINTR) continue;
+        return n;
+    }
+}
 
-template <typename opt>
-struct is_values_option {
-    static constexpr bool value = opt::is_values;
-};
+/// A file descriptor that is closed when this goes out of scope.
+class file_descriptor {
+    int fd;
 
-/// Check if an option is a regular option.
-template <typename opt>
-struct regular_option {
-    static constexpr bool value = not is<typename opt::canonical_type, special_tag>;
-};
+public:
+    /// The size of files whose size we can’t know in advance, e.g. pipes.
+    static constexpr std::int64_t unknown_size = -2;
 
-/// Check if an option is a special option.
-template <typename opt>
-struct special_option {
-    static constexpr bool value = not regular_option<opt>::value;
-};
+    /// Open a file for reading; \c path must be NUL-terminated.
+    explicit file_descriptor(std::string_view path, int flags = 0)
+        : fd{::open(path.data(), O_RDONLY | O_CLOEXEC | flags)} {}
 
-// ===========================================================================
-//  Main Implementation.
-// ===========================================================================
-template <typename... opts>
-class clopts_impl;
+    file_descriptor(const file_descriptor&) = delete;
+    file_descriptor& operator=(const file_descriptor&) = delete;
+    ~file_descriptor() {
+        if (fd >= 0) ::close(fd);
+    }
 
-template <typename... opts, typename... special>
-class clopts_impl<list<opts...>, list<special...>> {
-    // This should never be instantiated by the user.
-    explicit clopts_impl() = default;
-    ~clopts_impl() = default;
-    clopts_impl(const clopts_impl& o) = delete;
-    clopts_impl(clopts_impl&& o) = delete;
-    clopts_impl& operator=(const clopts_impl& o) = delete;
-    clopts_impl& operator=(clopts_impl&& o) = delete;
+    /// Check if the file was opened successfully.
+    explicit operator bool() const { return fd >= 0; }
 
-    // =======================================================================
-    //  Option Access by Name.
-    // =======================================================================
-    /// Option names.
-    static constexpr std::array<const char*, sizeof...(opts)> opt_names{opts::name.arr...};
+    /// Get the file descriptor.
+    [[nodiscard]] int get() const { return fd; }
 
-    /// Get the index of an option.
-    template <size_t index, static_string option>
-    static constexpr size_t optindex_impl() {
-        if constexpr (index >= sizeof...(opts)) return index;
-        else if constexpr (CLOPTS_STRCMP(opt_names[index], option.arr) == 0) return index;
-        else return optindex_impl<index + 1, option>();
+    /// \brief Get the size of the file, \c unknown_size if it is a pipe or socket, or -1 on error.
+    ///
+    /// Devices report the size the kernel gives them, which is usually 0, since
+    /// reading e.g. \c /dev/zero until the end would never stop. Pass \c true
+    /// for \p read_devices to get \c unknown_size for them as well if the caller
+    /// limits how much it reads.
+    [[nodiscard]] auto size(bool read_devices = false) const -> std::int64_t {
+        struct stat s {};
+        if (::fstat(fd, &s)) return -1;
+        if (S_ISFIFO(s.st_mode) or S_ISSOCK(s.st_mode)) return unknown_size;
+        if (read_devices and (S_ISCHR(s.st_mode) or S_ISBLK(s.st_mode))) return unknown_size;
+        return s.st_size;
     }
 
-#if __cpp_static_assert >= 202306L
-    template <static_string option>
-    static consteval auto format_invalid_option_name() -> static_string<option.size() + 45> {
-        static_string<option.size() + 45> ret;
-        ret.append("There is no option with the name '");
-        ret.append(option.data(), option.size());
-        ret.append("'");
-        return ret;
+    /// Read the file from the current position to the end (or \p limit) into the contents of a file<>.
+    template <typename contents_type>
+    [[nodiscard]] int read_until_eof(
+        contents_type& contents,
+        std::size_t limit = std::numeric_limits<std::size_t>::max(),
+        bool truncate = false
+    ) const {
+        auto read = [&](void* buffer, std::size_t size) { return read_some(fd, buffer, size); };
+        return detail::read_until_eof(contents, read, limit, truncate);
     }
-#endif
+};
 
-    template <bool ok, static_string option>
-    static consteval void assert_valid_option_name() {
-#if __cpp_static_assert >= 202306L
-        static_assert(ok, format_invalid_option_name<option>());
-#else
-        static_assert(ok, "Invalid option name. You've probably misspelt an option.");
-#endif
+/// \brief Read from a file at an offset until the buffer is full or we hit the end.
+///
+/// \return The number of bytes read, or -1 on error.
+inline auto read_at(int fd, void* buffer, std::size_t size, std::size_t offset) -> std::int64_t {
+    std::size_t n_read = 0;
+    while (n_read < size) {
+        auto n = ::pread(fd, static_cast<char*>(buffer) + n_read, size - n_read, off_t(offset + n_read));
+        if (n < 0 and errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+        n_read += std::size_t(n);
     }
+    return std::int64_t(n_read);
+}
+#endif
 
-    /// Get the index of an option and raise an error if the option is not found.
-    template <static_string option>
-    static constexpr size_t optindex() {
-        constexpr size_t sz = optindex_impl<0, option>();
-        assert_valid_option_name<(sz < sizeof...(opts)), option>();
-        return sz;
+#if CLOPTS_USE_IO_URING
+/// \brief A minimal io_uring instance.
+///
+/// This uses the system calls directly so we don’t depend on liburing. Only
+/// one thread may use a queue at a time, and it is up to the caller to make
+/// sure that there are never more requests in flight than there are entries.
+class io_uring_queue {
+    io_uring_params params{};
+    int fd;
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    std::size_t sq_ring_size{};
+    std::size_t cq_ring_size{};
+    unsigned sq_tail{};
+    unsigned submitted{};
+    unsigned completed{};
+
+    template <typename type>
+    static auto field(void* ring, std::uint32_t offset) -> type* {
+        return reinterpret_cast<type*>(static_cast<char*>(ring) + offset);
     }
 
-    /// Get an option by name.
-    // TODO: Use pack indexing once the syntax is fixed and compilers
-    // have actually started defining __cpp_pack_indexing.
-    template <static_string name>
-    using opt_by_name = nth_type<optindex<name>(), opts...>;
+    static auto load(unsigned* p) -> unsigned { return std::atomic_ref{*p}.load(std::memory_order_acquire); }
+    static void store(unsigned* p, unsigned value) { std::atomic_ref{*p}.store(value, std::memory_order_release); }
 
-    // I hate not having pack indexing.
-    template <std::size_t i, static_string str, static_string... strs>
-    static constexpr auto nth_str() {
-        if constexpr (i == 0) return str;
-        else return nth_str<i - 1, strs...>();
+public:
+    explicit io_uring_queue(unsigned entries)
+        : fd{int(::syscall(__NR_io_uring_setup, entries, &params))} {
+        if (fd < 0) return;
+
+        // Older kernels need the submission and completion rings to be mapped separately.
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+        static constexpr int prot = PROT_READ | PROT_WRITE;
+        static constexpr int flags = MAP_SHARED | MAP_POPULATE;
+        sq_ring = ::mmap(nullptr, sq_ring_size, prot, flags, fd, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) return;
+        cq_ring = single_mmap ? sq_ring : ::mmap(nullptr, cq_ring_size, prot, flags, fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) return;
+        sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), prot, flags, fd, IORING_OFF_SQES));
     }
 
-    // =======================================================================
-    //  Validation.
-    // =======================================================================
-    static_assert(sizeof...(opts) > 0, "At least one option is required");
-
-    /// Make sure no two options have the same name.
-    static consteval bool check_duplicate_options() {
-        // State is ok initially.
-        bool ok = true;
-        std::size_t i = 0;
+    io_uring_queue(const io_uring_queue&) = delete;
+    io_uring_queue& operator=(const io_uring_queue&) = delete;
+    ~io_uring_queue() {
+        if (sqes != MAP_FAILED) ::munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+        if (cq_ring != MAP_FAILED and cq_ring != sq_ring) ::munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) ::munmap(sq_ring, sq_ring_size);
+        if (fd >= 0) ::close(fd);
+    }
 
-        // Iterate over each option for each option.
-        While<opts...>(ok, [&]<typename opt>() {
-            std::size_t j = 0;
-            While<opts...>(ok, [&]<typename opt2>() {
-                // If the options are not the same, but their names are the same
-                // then this is an error. Iteration will stop at this point because
-                // \c ok is also the condition for the two loops.
-                ok = i == j or opt::name != opt2::name;
-                j++;
-            });
-            i++;
-        });
+    /// Check if the queue was set up successfully.
+    explicit operator bool() const { return fd >= 0 and sqes != MAP_FAILED; }
 
-        // Return whether everything is ok.
-        return ok;
+    /// Get an entry to fill in; it is submitted on the next call to \c submit().
+    [[nodiscard]] auto next() -> io_uring_sqe* {
+        auto index = sq_tail++ & *field<unsigned>(sq_ring, params.sq_off.ring_mask);
+        field<unsigned>(sq_ring, params.sq_off.array)[index] = index;
+        sqes[index] = {};
+        return &sqes[index];
     }
 
-    // This check is currently broken on MSVC 19.38 and later, for some reason.
-#if !defined(_MSC_VER) || defined(__clang__) || _MSC_VER < 1938
-    /// Make sure that no option has a prefix that is a short option.
-    static consteval bool check_short_opts() {
-        // State is ok initially.
-        bool ok = true;
-        std::size_t i = 0;
+    /// \brief Process all available completions.
+    ///
+    /// \return The number of completions processed.
+    template <typename callback>
+    auto reap(callback cb) -> unsigned {
+        auto* head_ptr = field<unsigned>(cq_ring, params.cq_off.head);
+        auto head = *head_ptr;
+        auto tail = load(field<unsigned>(cq_ring, params.cq_off.tail));
+        auto mask = *field<unsigned>(cq_ring, params.cq_off.ring_mask);
+        auto* cqes = field<io_uring_cqe>(cq_ring, params.cq_off.cqes);
+        for (auto i = head; i != tail; i++) cb(cqes[i & mask]);
+        store(head_ptr, tail);
+        completed += tail - head;
+        return tail - head;
+    }
 
-        // Iterate over each option for each option.
-        While<opts...>(ok, [&]<typename opt>() {
-            std::size_t j = 0;
-            While<opts...>(ok, [&]<typename opt2>() {
-                // Check the condition.
-                ok = i == j or not requires { opt::is_short; } or not opt2::name.sv().starts_with(opt::name.sv());
-                j++;
-            });
-            i++;
-        });
+    /// \brief Submit all pending entries and wait for at least one completion.
+    ///
+    /// \return 0 on success, or \c errno on error.
+    int submit_and_wait() {
+        store(field<unsigned>(sq_ring, params.sq_off.tail), sq_tail);
+        for (;;) {
+            auto n = CLOPTS_IO_URING_ENTER(fd, sq_tail - submitted, 1, IORING_ENTER_GETEVENTS);
+            if (n < 0 and (errno == EINTR or errno == EAGAIN or errno == EBUSY)) continue;
+            if (n < 0) return errno;
+            submitted += unsigned(n);
+            return 0;
+        }
+    }
 
-        // Return whether everything is ok.
-        return ok;
+    /// \brief Wait until every submitted entry has completed.
+    ///
+    /// Entries that were never submitted are dropped. This is what callers
+    /// must do if \c submit_and_wait() fails, since the kernel may still be
+    /// using the buffers of entries that are in flight.
+    ///
+    /// \return 0 on success, or \c errno if we can’t wait for them.
+    template <typename callback>
+    int drain(callback cb) {
+        sq_tail = submitted;
+        store(field<unsigned>(sq_ring, params.sq_off.tail), sq_tail);
+        while (submitted != completed) {
+            if (reap(cb)) continue;
+            auto n = CLOPTS_IO_URING_ENTER(fd, 0, 1, IORING_ENTER_GETEVENTS);
+            if (n < 0 and errno != EINTR and errno != EAGAIN and errno != EBUSY) return errno;
+        }
+        return 0;
     }
 
-    static_assert(check_short_opts(), "Option name may not start with the name of a short option");
+    /// Check if the kernel supports all of these operations.
+    [[nodiscard]] bool supports(std::initializer_list<unsigned> ops) const {
+        static constexpr unsigned max_ops = 256;
+        std::vector<std::byte> buffer(sizeof(io_uring_probe) + max_ops * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (::syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, max_ops) < 0) return false;
+        return std::ranges::all_of(ops, [&](unsigned op) {
+            return op <= probe->last_op and (probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        });
+    }
+};
 #endif
 
-    /// Make sure there is at most one multiple<positional<>> option.
-    static consteval size_t validate_multiple() {
-        auto is_mul = []<typename opt>() { return requires { opt::is_multiple; }; };
-        return (... + (is_mul.template operator()<opts>() and detail::is_positional_v<opts>) );
+/// Assign a path to the path of a file option, reusing its memory if we can.
+template <typename path_type>
+void assign_path(path_type& to, std::string_view path) {
+    if constexpr (requires { to.assign(path.begin(), path.end()); }) to.assign(path.begin(), path.end());
+    else to = path_type{path.begin(), path.end()};
+}
+
+/// \brief Load the contents of a file<> option into an existing value using its read strategy.
+///
+/// The contents must be empty; their memory is reused. On error, the path and
+/// the contents are cleared.
+template <typename file_data_type>
+void map_file_into(file_data_type& file, std::string_view path, auto error_handler) {
+    using strategy = typename file_data_type::read_strategy;
+    assign_path(file.path, path);
+    if (int error = strategy::read(path, file.contents)) {
+        file.path.clear();
+        if constexpr (requires { file.contents.clear(); }) file.contents.clear();
+        else file.contents = {};
+        error_handler(parse_error{.kind = error_kind::file_error, .argument = path, .error_code = error});
     }
+}
 
-    template <typename type, static_string... references>
-    static consteval bool validate_references_impl(ref<type, references...>) { // clang-format off
-        auto ValidateReference = []<static_string str>() {
-            return ((
-                // Name must reference an existing option.
-                opts::name == str and
-                // And that option must not also be a ref<> option; this is to
-                // prevent cycles.
-                not opts::is_ref
-            ) or ...);
-        };
-        return (ValidateReference.template operator()<references>() and ...);
-    } // clang-format on
+/// \brief Read-only view of the contents of a file that shares ownership of them.
+///
+/// If mmap() is available, this is a read-only mapping of the file; otherwise,
+/// the file is read into a buffer. Copies share the mapping, which is unmapped
+/// when the last of them is destroyed.
+class file_mapping {
+    const std::byte* ptr{};
+    std::size_t sz{};
+    std::shared_ptr<const void> owner;
 
-    /// Make sure all referenced values exist.
-    static consteval bool validate_references() {
-        bool ok = true;
-        While<opts...>(ok, [&]<typename opt> {
-            using type = typename opt::declared_type_base;
-            if constexpr (opt::is_ref) ok = validate_references_impl(type{});
-        });
-        return ok;
+public:
+    file_mapping() = default;
+    file_mapping(const file_mapping&) = default;
+    file_mapping& operator=(const file_mapping&) = default;
+
+    file_mapping(file_mapping&& other) noexcept { swap(other); }
+    file_mapping& operator=(file_mapping&& other) noexcept {
+        file_mapping tmp{std::move(other)};
+        swap(tmp);
+        return *this;
     }
 
-    /// Make sure we don’t have invalid option combinations.
-    static_assert(check_duplicate_options(), "Two different options may not have the same name");
-    static_assert(validate_multiple() <= 1, "Cannot have more than one multiple<positional<>> option");
-    static_assert(validate_references(), "All options with a ref<> type must reference an existing non-ref option");
+    /// \brief Map a file.
+    ///
+    /// \param path The path to the file; this must be NUL-terminated.
+    /// \param error Set to \c errno if the file could not be mapped.
+    /// \param writable If true, the mapping is private and writable, and it is
+    ///        followed by a zero byte that may be overwritten with another zero
+    ///        byte; see \c writable_view(). Files that can’t be mapped like that,
+    ///        e.g. pipes, are read instead.
+    static auto open(std::string_view path, int& error, bool writable = false) -> file_mapping {
+#if CLOPTS_USE_MMAP
+        file_descriptor fd{path};
+        auto sz = fd ? fd.size() : -1;
+
+        // Bytes past the end of the file are only mapped if it doesn’t end on a page boundary.
+        static const auto page_size = std::size_t(::sysconf(_SC_PAGESIZE));
+        if (writable and (sz == file_descriptor::unknown_size or (sz > 0 and std::size_t(sz) % page_size == 0))) {
+            auto buffer = std::make_shared<std::string>();
+            if (int e = fd.read_until_eof(*buffer)) {
+                error = e;
+                return {};
+            }
 
-    // =======================================================================
-    //  Option Storage.
-    // =======================================================================
-    template <typename opt>
-    struct storage_type;
+            file_mapping m;
+            m.ptr = reinterpret_cast<const std::byte*>(buffer->data());
+            m.sz = buffer->size();
+            m.owner = std::move(buffer);
+            return m;
+        }
 
-    template <typename opt>
-    using storage_type_t = typename storage_type<opt>::type;
+        if (sz == file_descriptor::unknown_size) {
+            error = ENODEV;
+            return {};
+        }
 
-    template <typename opt>
-    using single_element_storage_type_t = remove_vector_t<storage_type_t<opt>>;
+        if (sz < 0) {
+            error = errno;
+            return {};
+        }
 
-    template <typename, typename>
-    struct compute_ref_storage_type {
-        // Needed so we can instantiate this with an invalid type, even
-        // though we never actually use it (yes, there are other ways
-        // around this but I can’t be bothered).
-        using type = void;
-    };
+        // Empty files can’t be mapped, but there is nothing to map anyway. The
+        // mapping stays valid after the file is closed.
+        if (sz == 0) return {};
+        auto* mem = ::mmap(nullptr, std::size_t(sz), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (mem == MAP_FAILED) {
+            error = errno;
+            return {};
+        }
 
-    /// The type used to store a (possibly empty) copy of an option type.
-    template <typename opt>
-    using ref_storage_type_t = // clang-format off
-        // For flags, just store a bool.
-        std::conditional_t<is_same<storage_type_t<opt>, bool>, bool,
-        // For multiple<> options, store a vector, because we need to deep-copy the state.
-        std::conditional_t<is_vector_v<storage_type_t<opt>>, storage_type_t<opt>,
-        // Otherwise, store an optional, since the value may be empty.
-        std::optional<storage_type_t<opt>>
-    >>; // clang-format on
+        file_mapping m;
+        m.ptr = static_cast<const std::byte*>(mem);
+        m.sz = std::size_t(sz);
+        m.owner = std::shared_ptr<const void>{mem, [sz](const void* p) { ::munmap(const_cast<void*>(p), std::size_t(sz)); }};
+        return m;
+#else
+        std::unique_ptr<FILE, decltype(&std::fclose)> f{std::fopen(path.data(), "rb"), std::fclose};
+        if (not f) {
+            error = errno;
+            return {};
+        }
 
-    template <typename declared_type, typename declared_type_base, static_string... args>
-    struct compute_ref_storage_type<declared_type, ref<declared_type_base, args...>> { // clang-format off
-        using tuple = std::tuple<
-            option_type_t<declared_type_base>,
-            ref_storage_type_t<opt_by_name<args>>...
-        >;
+        // Get the file size.
+        std::fseek(f.get(), 0, SEEK_END);
+        auto sz = std::size_t(std::ftell(f.get()));
+        std::fseek(f.get(), 0, SEEK_SET);
+
+        // Read the file.
+        file_mapping m;
+        auto buffer = std::make_shared_for_overwrite<std::byte[]>(sz + writable);
+        m.ptr = buffer.get();
+        m.sz = std::fread(buffer.get(), 1, sz, f.get());
+        if (writable) buffer[m.sz] = {};
+        m.owner = std::move(buffer);
+        if (std::ferror(f.get())) {
+            error = errno;
+            return {};
+        }
 
-        using type = std::conditional_t<is_vector_v<declared_type>, std::vector<tuple>, tuple>;
-    }; // clang-format on
+        return m;
+#endif
+    }
 
-    /// Helper to determine the type used to store an option value.
+    /// Get the contents as bytes.
+    [[nodiscard]] auto bytes() const -> std::span<const std::byte> { return {ptr, sz}; }
+
+    /// Get a pointer to the contents.
+    [[nodiscard]] auto data() const -> const std::byte* { return ptr; }
+
+    /// Check if the file is empty.
+    [[nodiscard]] bool empty() const { return sz == 0; }
+
+    /// Get the size of the file.
+    [[nodiscard]] auto size() const -> std::size_t { return sz; }
+
+    /// Swap two mappings.
+    void swap(file_mapping& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(sz, other.sz);
+        std::swap(owner, other.owner);
+    }
+
+    /// Get the contents as a string.
+    [[nodiscard]] auto view() const -> std::string_view {
+        return {reinterpret_cast<const char*>(ptr), sz};
+    }
+
+    /// \brief Get the contents of a writable mapping.
     ///
-    /// This is usually just the canonical type, but for options that
-    /// reference other options, we need to add all the references as
-    /// well.
-    template <typename opt>
-    struct storage_type {
-        using type = std::conditional_t<
-            opt::is_ref,
-            compute_ref_storage_type<typename opt::declared_type, typename opt::declared_type_base>,
-            std::type_identity<typename opt::canonical_type>
-        >::type;
+    /// Only use this if the file was opened with \c writable set to \c true.
+    /// Changes are not written back to the file and are visible to all copies
+    /// of this mapping.
+    [[nodiscard]] auto writable_view() const -> std::span<char> {
+        return {const_cast<char*>(reinterpret_cast<const char*>(ptr)), sz};
+    }
+};
+
+#if CLOPTS_USE_MMAP
+/// Identifies a file and the version of its contents, no matter what path it is opened by.
+struct file_identity {
+    std::uint64_t device;
+    std::uint64_t inode;
+    std::int64_t mtime_sec;
+    std::int64_t mtime_nsec;
+
+    bool operator==(const file_identity&) const = default;
+
+    /// Get the identity of a file, or \c std::nullopt if we can’t stat it.
+    static auto of(std::string_view path) -> std::optional<file_identity> {
+        struct stat s {};
+        if (::stat(path.data(), &s) or not S_ISREG(s.st_mode)) return std::nullopt;
+        return file_identity{
+            .device = std::uint64_t(s.st_dev),
+            .inode = std::uint64_t(s.st_ino),
+            .mtime_sec = std::int64_t(s.st_mtim.tv_sec),
+            .mtime_nsec = std::int64_t(s.st_mtim.tv_nsec),
+        };
+    }
+
+    struct hash {
+        auto operator()(const file_identity& id) const -> std::size_t {
+            auto h = std::hash<std::uint64_t>{}(id.inode);
+            h = h * 31 + std::hash<std::uint64_t>{}(id.device);
+            return h * 31 + std::hash<std::int64_t>{}(id.mtime_nsec);
+        }
     };
+};
+#endif
 
-    /// The type returned to the user by 'get<>().
-    template <typename opt>
-    using get_return_type = // clang-format off
-        // For flags, just return a bool.
-        std::conditional_t<is_same<typename opt::canonical_type, bool>, bool,
-        // For multiple<> options, return a span.
-        std::conditional_t<is_vector_v<storage_type_t<opt>>, std::span<single_element_storage_type_t<opt>>,
-        // Otherwise, return a pointer.
-        storage_type_t<opt>*
-    >>; // clang-format on
+/// Map a file for a mapped_file<> option.
+template <typename mapped_file_type>
+auto map_file_readonly(std::string_view path, auto error_handler) -> mapped_file_type {
+    int error = 0;
+    auto mapping = file_mapping::open(path, error);
+    if (error) {
+        error_handler(parse_error{.kind = error_kind::file_error, .argument = path, .error_code = error});
+        return {};
+    }
 
-    /// Various types.
-    using help_string_t = static_string<1024 + 1024 * sizeof...(opts)>; // Size should be ‘big enough’™.
-    using optvals_tuple_t = std::tuple<storage_type_t<opts>...>;
-    using string = std::string;
-    using integer = int64_t;
+    return mapped_file_type{
+        typename mapped_file_type::path_type{path.begin(), path.end()},
+        std::move(mapping),
+    };
+}
 
-    static constexpr bool has_stop_parsing = (requires { special::is_stop_parsing; } or ...);
+/// \brief Call a function with the position of every occurrence of a character in a string.
+///
+/// If \c CLOPTS_USE_SIMD is enabled, this compares 64 bytes at a time with AVX2
+/// or 16 bytes at a time with SSE2, and one byte at a time otherwise.
+template <char c>
+void for_each_occurrence(std::string_view text, auto callback) {
+    auto* data = text.data();
+    std::size_t i = 0;
+    [[maybe_unused]] auto report = [&](std::size_t base, auto mask) {
+        for (; mask; mask &= mask - 1) callback(base + std::size_t(std::countr_zero(mask)));
+    };
 
-public:
-    using error_handler_t = std::function<bool(std::string&&)>;
+#if CLOPTS_USE_SIMD and defined(__AVX2__)
+    auto needle32 = _mm256_set1_epi8(c);
+    for (; i + 64 <= text.size(); i += 64) {
+        auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        auto mask_lo = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle32)));
+        auto mask_hi = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle32)));
+        report(i, std::uint64_t(mask_hi) << 32 | mask_lo);
+    }
+#endif
 
-    // =======================================================================
-    //  Option Access.
-    // =======================================================================
-    /// Result type.
-    class optvals_type {
-        friend clopts_impl;
-        optvals_tuple_t optvals{};
-        std::bitset<sizeof...(opts)> opts_found{};
-        std::conditional_t<has_stop_parsing, std::span<const char*>, empty> unprocessed_args{};
+#if CLOPTS_USE_SIMD
+    auto needle16 = _mm_set1_epi8(c);
+    for (; i + 16 <= text.size(); i += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        report(i, std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle16))));
+    }
+#endif
 
-        // This implements get<>() and get_or<>().
-        template <static_string s>
-        constexpr auto get_impl() -> get_return_type<opt_by_name<s>> {
-            using canonical = typename opt_by_name<s>::canonical_type;
+    for (; i < text.size(); i++)
+        if (data[i] == c) callback(i);
+}
 
-            // Bool options don’t have a value. Instead, we just return whether the option was found.
-            if constexpr (std::is_same_v<canonical, bool>) return opts_found[optindex<s>()];
+/// A range of arguments that we can parse instead of argv.
+///
+/// The strings must not be temporaries, since we keep pointers to them.
+template <typename range>
+concept argument_range = std::ranges::input_range<range> and
+                         std::convertible_to<std::ranges::range_reference_t<range>, std::string_view> and
+                         (std::is_lvalue_reference_v<std::ranges::range_reference_t<range>> or
+                          std::is_trivially_copyable_v<std::ranges::range_reference_t<range>>);
+
+/// \brief A type-erased range of arguments.
+///
+/// This refers to an iterator and a sentinel, which must outlive it.
+class argument_source {
+    void* cursor{};
+    bool (*fetch)(void*, std::string_view&){};
 
-            // We always return a span to multiple<> options because the user can just check if it’s empty.
-            else if constexpr (detail::is_vector_v<canonical>) return std::get<optindex<s>()>(optvals);
+public:
+    argument_source() = default;
+
+    template <typename iterator, typename sentinel>
+    explicit argument_source(std::pair<iterator, sentinel>& range)
+        : cursor{&range}, fetch{[](void* p, std::string_view& arg) {
+              auto& [it, end] = *static_cast<std::pair<iterator, sentinel>*>(p);
+              if (it == end) return false;
+              arg = std::string_view(*it);
+              ++it;
+              return true;
+          }} {}
+
+    /// Refer to anything that produces arguments one at a time, e.g. a tokenizer.
+    template <typename generator>
+    requires requires (generator& g, std::string_view& arg) { { g.next(arg) } -> std::same_as<bool>; }
+    explicit argument_source(generator& g)
+        : cursor{&g}, fetch{[](void* p, std::string_view& arg) { return static_cast<generator*>(p)->next(arg); }} {}
+
+    /// Check if this refers to a range.
+    explicit operator bool() const { return fetch != nullptr; }
+
+    /// \brief Get the next argument.
+    ///
+    /// \return false if there are no arguments left.
+    bool next(std::string_view& arg) { return fetch(cursor, arg); }
+};
 
-            // Function options don’t have a value.
-            else if constexpr (detail::is_callback<canonical>) CLOPTS_ERR("Cannot call get<>() on an option with function type.");
+/// \brief Stores NUL-terminated copies of strings; the copies never move.
+///
+/// The copies are stored in blocks that are kept when the copies are cleared,
+/// so copying the same strings again doesn’t allocate.
+class string_copies {
+    static constexpr std::size_t block_size = 4096;
+
+    struct block {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
 
-            // Otherwise, return nullptr if the option wasn’t found, and a pointer to the value otherwise.
-            else return not opts_found[optindex<s>()] ? nullptr : std::addressof(std::get<optindex<s>()>(optvals));
+    std::vector<block> blocks;
+    std::size_t current = 0;
+    std::size_t used = 0;
+
+public:
+    /// Copy a string.
+    auto add(std::string_view s) -> const char* {
+        auto needed = s.size() + 1;
+        while (current < blocks.size() and blocks[current].size - used < needed) {
+            current++;
+            used = 0;
         }
 
-    public:
-        /// \brief Get the value of an option.
-        ///
-        /// This is not \c [[nodiscard]] because that raises an ICE when compiling
-        /// with some older versions of GCC.
-        ///
-        /// \return \c true / \c false if the option is a flag
-        /// \return \c nullptr if the option was not found
-        /// \return a pointer to the value if the option was found
-        ///
-        /// \see get_or()
-        template <static_string s>
-        constexpr auto get() {
-            // Check if the option exists before calling get_impl<>() so we trigger the static_assert
-            // below before hitting a complex template instantiation error.
-            constexpr auto sz = optindex_impl<0, s>();
-            if constexpr (sz < sizeof...(opts)) return get_impl<s>();
-            else assert_valid_option_name<(sz < sizeof...(opts)), s>();
+        if (current == blocks.size()) {
+            auto size = std::max(block_size, needed);
+            blocks.push_back({std::make_unique_for_overwrite<char[]>(size), size});
         }
 
-        /// \brief Get the value of an option or a default value if the option was not found.
-        ///
-        /// The default value is \c static_cast to the type of the option value.
-        ///
-        /// \param default_ The default value to return if the option was not found.
-        /// \return \c default_ if the option was not found.
-        /// \return a copy of the option value if the option was found.
-        ///
-        /// \see get()
-        template <static_string s>
-        constexpr auto get_or(auto default_) {
-            constexpr auto sz = optindex_impl<0, s>();
-            if constexpr (sz < sizeof...(opts)) {
-                if (opts_found[optindex<s>()]) return *get_impl<s>();
-                return static_cast<std::remove_cvref_t<decltype(*get_impl<s>())>>(default_);
-            } else {
-                assert_valid_option_name<(sz < sizeof...(opts)), s>();
-            }
+        auto* copy = blocks[current].data.get() + used;
+        std::memcpy(copy, s.data(), s.size());
+        copy[s.size()] = 0;
+        used += needed;
+        return copy;
+    }
+
+    /// Discard all copies, but keep the memory.
+    void clear() {
+        current = 0;
+        used = 0;
+    }
+};
+
+/// Check if a character separates arguments in a response file.
+constexpr bool is_argument_separator(char c) {
+    return static_cast<unsigned char>(c) <= ' ';
+}
+
+/// \brief Classifies the characters of a 64-byte block of arguments.
+///
+/// Bit \c i of each mask is set if the character at offset \c i is of that
+/// kind; bits past the end of the text are never set.
+struct argument_block {
+    std::uint64_t separators{};
+    std::uint64_t single_quotes{};
+    std::uint64_t double_quotes{};
+    std::uint64_t backslashes{};
+    std::uint64_t valid{};
+
+    /// Classify up to 64 characters, using AVX2 or SSE2 if \c CLOPTS_USE_SIMD is enabled.
+    static auto classify(const char* text, std::size_t size) -> argument_block {
+        // Copy the last block so we don’t read past the end of the text.
+        alignas(64) char tail[64]{};
+        if (size < 64) {
+            std::memcpy(tail, text, size);
+            text = tail;
         }
 
-        /// \brief Get unprocessed options.
-        ///
-        /// If the \c stop_parsing\<> option was encountered, this will return the
-        /// remaining options that have not been processed by this parser. If there
-        /// is no \c stop_parsing\<> option, this will always return an empty span.
-        ///
-        /// If there was an error during parsing, the return value of this function
-        /// is unspecified.
-        [[nodiscard]] auto unprocessed() const -> std::span<const char*> {
-            if constexpr (has_stop_parsing) return unprocessed_args;
-            else return {};
+        argument_block b;
+        b.valid = size < 64 ? (std::uint64_t(1) << size) - 1 : ~std::uint64_t(0);
+#if CLOPTS_USE_SIMD and defined(__AVX2__)
+        for (int i = 0; i < 64; i += 32) {
+            auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+            auto mask = [&](__m256i eq) { return std::uint64_t(std::uint32_t(_mm256_movemask_epi8(eq))) << i; };
+            b.separators |= mask(_mm256_cmpeq_epi8(_mm256_max_epu8(block, _mm256_set1_epi8(' ')), _mm256_set1_epi8(' ')));
+            b.single_quotes |= mask(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\'')));
+            b.double_quotes |= mask(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('"')));
+            b.backslashes |= mask(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\\')));
         }
-    };
+#elif CLOPTS_USE_SIMD
+        for (int i = 0; i < 64; i += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+            auto mask = [&](__m128i eq) { return std::uint64_t(std::uint32_t(_mm_movemask_epi8(eq))) << i; };
+            b.separators |= mask(_mm_cmpeq_epi8(_mm_max_epu8(block, _mm_set1_epi8(' ')), _mm_set1_epi8(' ')));
+            b.single_quotes |= mask(_mm_cmpeq_epi8(block, _mm_set1_epi8('\'')));
+            b.double_quotes |= mask(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')));
+            b.backslashes |= mask(_mm_cmpeq_epi8(block, _mm_set1_epi8('\\')));
+        }
+#else
+        for (int i = 0; i < 64; i++) {
+            auto bit = std::uint64_t(1) << i;
+            if (is_argument_separator(text[i])) b.separators |= bit;
+            else if (text[i] == '\'') b.single_quotes |= bit;
+            else if (text[i] == '"') b.double_quotes |= bit;
+            else if (text[i] == '\\') b.backslashes |= bit;
+        }
+#endif
+        b.separators &= b.valid;
+        b.single_quotes &= b.valid;
+        b.double_quotes &= b.valid;
+        b.backslashes &= b.valid;
+        return b;
+    }
+};
 
-private:
-    // =======================================================================
-    //  Parser State.
-    // =======================================================================
-    /// Variables for the parser and for storing parsed options.
-    optvals_type optvals{};
-    bool has_error = false;
-    int argc{};
-    int argi{};
-    const char** argv{};
-    void* user_data{};
-    error_handler_t error_handler{};
+/// \brief Splits text into arguments, like a shell would.
+///
+/// Arguments are separated by whitespace. Backslashes escape the next
+/// character, and quotes group characters into a single argument; inside
+/// double quotes, backslashes only escape \c " and \c \\, and inside single
+/// quotes, they are not special at all.
+///
+/// Arguments are unescaped in place and NUL-terminated, so the byte after the
+/// end of the text must be writable; the text is overwritten in the process.
+///
+/// The text is classified 64 bytes at a time, and the tokenizer then jumps
+/// from one interesting character to the next; this only works because
+/// unescaping never writes past the character we’re looking at.
+class argument_tokenizer {
+    char* it{};
+    char* end{};
+    char* block_start{};
+    argument_block block{};
+
+    /// Find the first character at or after \c it that any of the masks chosen by \c select has a bit set for.
+    auto find(auto select) -> char* {
+        for (auto* p = it;;) {
+            if (p >= block_start + 64 or not block_start) {
+                if (p >= end) return end;
+                block_start = p;
+                block = argument_block::classify(p, std::min<std::size_t>(64, std::size_t(end - p)));
+            }
 
-    // =======================================================================
-    //  Helpers.
-    // =======================================================================
-    /// Error handler that is used if the user doesn’t provide one.
-    bool default_error_handler(std::string&& errmsg) {
-        auto name = program_name();
-        if (not name.empty()) std::cerr << name << ": ";
-        std::cerr << errmsg << "\n";
+            if (auto mask = select(block) >> (p - block_start)) return p + std::countr_zero(mask);
+            p = block_start + 64;
+        }
+    }
 
-        // Invoke the help option.
-        bool invoked = false;
-        auto invoke = [&]<typename opt> {
-            if constexpr (requires { opt::is_help_option; }) {
-                invoked = true;
-                invoke_help_callback<opt>();
-            }
-        };
+    /// Copy the characters up to \c to to \c out.
+    void copy_to(char*& out, char* to) {
+        if (out != it) std::memmove(out, it, std::size_t(to - it));
+        out += to - it;
+        it = to;
+    }
 
-        // If there is a help option, invoke it.
-        (invoke.template operator()<opts>(), ...);
+public:
+    argument_tokenizer() = default;
+    explicit argument_tokenizer(std::span<char> text) : it{text.data()}, end{text.data() + text.size()} {}
 
-        // If no help option was found, print the help message.
-        if (not invoked) {
-            std::cerr << "Usage: ";
-            if (not name.empty()) std::cerr << name << " ";
-            std::cerr << help();
+    /// \brief Get the next argument.
+    ///
+    /// \return false if there are no arguments left.
+    bool next(std::string_view& arg) {
+        it = find([](const argument_block& b) { return ~b.separators & b.valid; });
+        if (it == end) return false;
+
+        // Most arguments don’t contain any quotes or escapes, so copy
+        // characters only once we’ve had to remove one.
+        auto* start = it;
+        auto* out = it;
+        for (;;) {
+            copy_to(out, find([](const argument_block& b) { return b.separators | b.single_quotes | b.double_quotes | b.backslashes; }));
+            if (it == end or is_argument_separator(*it)) break;
+
+            switch (*it++) {
+                case '\\':
+                    if (it != end) *out++ = *it++;
+                    break;
+
+                case '\'':
+                    copy_to(out, find([](const argument_block& b) { return b.single_quotes; }));
+                    if (it != end) it++;
+                    break;
+
+                default:
+                    for (;;) {
+                        copy_to(out, find([](const argument_block& b) { return b.double_quotes | b.backslashes; }));
+                        if (it == end) break;
+                        if (*it++ == '"') break;
+                        if (it != end and (*it == '"' or *it == '\\')) *out++ = *it++;
+                        else *out++ = '\\';
+                    }
+                    break;
+            }
         }
 
-        std::exit(1);
+        // The terminator overwrites the separator (or something we’ve unescaped).
+        if (it != end) it++;
+        *out = 0;
+        arg = {start, std::size_t(out - start)};
+        return true;
     }
+};
 
-    /// Invoke the error handler and set the error flag.
-    void handle_error(auto first, auto&&... msg_parts) {
-        // Append the message parts.
-        std::string msg = std::string{std::move(first)};
-        ((msg += std::forward<decltype(msg_parts)>(msg_parts)), ...);
+/// \brief Splits text at NUL bytes, like the contents of \c /proc/<pid>/cmdline.
+///
+/// Every argument is terminated by a NUL byte except for possibly the last
+/// one, so the byte after the end of the text must be a NUL byte. Nothing
+/// is unescaped, and empty arguments are kept.
+class nul_separated_arguments {
+    const char* it{};
+    const char* end{};
 
-        // Dispatch the error.
-        has_error = not error_handler(std::move(msg));
+public:
+    explicit nul_separated_arguments(std::span<const char> text) : it{text.data()}, end{text.data() + text.size()} {}
+
+    /// \brief Get the next argument.
+    ///
+    /// \return false if there are no arguments left.
+    bool next(std::string_view& arg) {
+        if (it == end) return false;
+        auto* nul = static_cast<const char*>(std::memchr(it, 0, std::size_t(end - it)));
+        if (not nul) nul = end;
+        arg = {it, std::size_t(nul - it)};
+        it = nul == end ? end : nul + 1;
+        return true;
     }
+};
 
-    /// Invoke the help callback of the help option.
-    template <typename opt>
-    void invoke_help_callback() {
-        // New API: program name + help message [+ user data].
-        using sv = std::string_view;
-        if constexpr (requires { opt::help_callback(sv{}, sv{}, user_data); })
-            opt::help_callback(sv{program_name()}, sv{}, user_data);
-        else if constexpr (requires { opt::help_callback(sv{}, sv{}); })
-            opt::help_callback(sv{program_name()}, help_message_raw.sv());
+/// \brief A copy of a command line that arguments are split from.
+///
+/// The buffer is shared between copies of the option values that point into
+/// it; it is reused if nothing else refers to it anymore and it is big enough.
+class command_line_buffer {
+    std::shared_ptr<char[]> data;
+    std::size_t capacity{};
+
+public:
+    /// \brief Copy a command line into the buffer.
+    ///
+    /// \return The copy, which is followed by a NUL byte.
+    auto assign(std::string_view command_line) -> std::span<char> {
+        if (not data or data.use_count() > 1 or capacity < command_line.size() + 1) {
+            capacity = std::max(command_line.size() + 1, data.use_count() > 1 ? 0 : capacity * 2);
+            data = std::shared_ptr<char[]>(new char[capacity]);
+        }
+
+        std::memcpy(data.get(), command_line.data(), command_line.size());
+        data[command_line.size()] = 0;
+        return {data.get(), command_line.size()};
+    }
+};
+
+/// \brief A file that is read from front to back, such as a pipe.
+///
+/// This owns the file unless it is stdin, which is never closed.
+class stream_handle {
+#if CLOPTS_USE_MMAP
+    int fd = -1;
+#else
+    std::FILE* f = nullptr;
+#endif
+    bool owned = false;
+
+public:
+    stream_handle() = default;
+    stream_handle(const stream_handle&) = delete;
+    stream_handle& operator=(const stream_handle&) = delete;
+
+    stream_handle(stream_handle&& other) noexcept { swap(other); }
+    stream_handle& operator=(stream_handle&& other) noexcept {
+        stream_handle tmp{std::move(other)};
+        swap(tmp);
+        return *this;
+    }
+
+    ~stream_handle() {
+        if (not owned) return;
+#if CLOPTS_USE_MMAP
+        ::close(fd);
+#else
+        std::fclose(f);
+#endif
+    }
+
+    /// \brief Open a file for reading.
+    ///
+    /// \param path The path to the file, or \c - for stdin; this must be NUL-terminated.
+    /// \param error Set to \c errno if the file could not be opened.
+    static auto open(std::string_view path, int& error) -> stream_handle {
+        stream_handle h;
+#if CLOPTS_USE_MMAP
+        if (path == "-") {
+            h.fd = STDIN_FILENO;
+            return h;
+        }
+
+        h.fd = ::open(path.data(), O_RDONLY | O_CLOEXEC);
+        if (h.fd < 0) {
+            error = errno;
+            return {};
+        }
+
+        // Reading a directory only fails once we try to read it, so check now.
+        h.owned = true;
+        struct stat s {};
+        if (::fstat(h.fd, &s)) error = errno;
+        else if (S_ISDIR(s.st_mode)) error = EISDIR;
+        else if (S_ISREG(s.st_mode)) ::posix_fadvise(h.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        if (error) return {};
+#else
+        if (path == "-") {
+            h.f = stdin;
+            return h;
+        }
+
+        h.f = std::fopen(path.data(), "rb");
+        if (not h.f) {
+            error = errno;
+            return {};
+        }
+
+        h.owned = true;
+#endif
+        return h;
+    }
+
+    /// \brief Read the next part of the file.
+    ///
+    /// \return The number of bytes read, 0 at the end of the file, or -1 on error.
+    auto read(void* buffer, std::size_t size) -> std::int64_t {
+#if CLOPTS_USE_MMAP
+        return read_some(fd, buffer, size);
+#else
+        if (not f) {
+            errno = EBADF;
+            return -1;
+        }
+
+        auto n = std::fread(buffer, 1, size, f);
+        return n == 0 and std::ferror(f) ? -1 : std::int64_t(n);
+#endif
+    }
+
+    /// Swap two handles.
+    void swap(stream_handle& other) noexcept {
+#if CLOPTS_USE_MMAP
+        std::swap(fd, other.fd);
+#else
+        std::swap(f, other.f);
+#endif
+        std::swap(owned, other.owned);
+    }
+};
+
+/// Open the file of a stream<> option.
+template <typename stream_type>
+auto open_stream(std::string_view path, auto error_handler) -> stream_type {
+    int error = 0;
+    auto handle = stream_handle::open(path, error);
+    if (error) {
+        error_handler(parse_error{.kind = error_kind::file_error, .argument = path, .error_code = error});
+        return {};
+    }
+
+    return stream_type{path, std::move(handle)};
+}
+
+/// \brief An output file with a write buffer.
+///
+/// Data is written through the buffer, which is only allocated on the first
+/// write; alternatively, the file can be mapped and written to directly. The
+/// buffer is flushed when the handle is closed or destroyed.
+class output_handle {
+#if CLOPTS_USE_MMAP
+    int fd = -1;
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+#else
+    std::FILE* f = nullptr;
+    std::string path;
+#endif
+    std::unique_ptr<char[]> buffer;
+    std::size_t buffer_size = 0;
+    std::size_t buffered = 0;
+    int err = 0;
+    bool owned = false;
+    bool truncate_pending = false;
+
+    /// Write data to the file, bypassing the buffer.
+    void write_unbuffered(const char* data, std::size_t size) {
+        truncate();
+#if CLOPTS_USE_MMAP
+        while (size and not err) {
+            auto n = ::write(fd, data, size);
+            if (n < 0) {
+                if (errno != EINTR) err = errno;
+                continue;
+            }
+
+            data += n;
+            size -= std::size_t(n);
+        }
+#else
+        if (not f) err = EBADF;
+        else if (std::fwrite(data, 1, size, f) != size) err = errno ? errno : EIO;
+#endif
+    }
+
+    /// Write data that doesn’t fit into the buffer.
+    void write_slow(const char* data, std::size_t size) {
+        flush();
+        if (size >= buffer_size) return write_unbuffered(data, size);
+        if (not buffer) buffer = std::make_unique_for_overwrite<char[]>(buffer_size);
+        std::memcpy(buffer.get(), data, size);
+        buffered = size;
+    }
+
+public:
+    output_handle() = default;
+    output_handle(const output_handle&) = delete;
+    output_handle& operator=(const output_handle&) = delete;
+
+    output_handle(output_handle&& other) noexcept { swap(other); }
+    output_handle& operator=(output_handle&& other) noexcept {
+        output_handle tmp{std::move(other)};
+        swap(tmp);
+        return *this;
+    }
+
+    ~output_handle() { (void) close(); }
+
+    /// \brief Create a file for writing.
+    ///
+    /// An existing file is not truncated until \c truncate() is called, so
+    /// its contents survive if we end up not writing to it after all.
+    ///
+    /// \param path The path to the file, or \c - for stdout; this must be NUL-terminated.
+    /// \param size_hint How many bytes to reserve on disk for the file, or 0.
+    /// \param buffer_size The size of the write buffer.
+    /// \param error Set to \c errno if the file could not be opened.
+    static auto open(std::string_view path, std::size_t size_hint, std::size_t buffer_size, int& error) -> output_handle {
+        output_handle h;
+        h.buffer_size = buffer_size;
+#if CLOPTS_USE_MMAP
+        if (path == "-") {
+            h.fd = STDOUT_FILENO;
+            return h;
+        }
+
+        // Mapping the file requires read access, but we don’t need it to write to it.
+        h.fd = ::open(path.data(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        if (h.fd < 0 and errno == EACCES) h.fd = ::open(path.data(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+        if (h.fd < 0) {
+            error = errno;
+            return {};
+        }
+
+        // Only regular files can be truncated; writing to e.g. a pipe or /dev/null doesn’t need it.
+        h.owned = true;
+        struct stat s {};
+        bool regular = not ::fstat(h.fd, &s) and S_ISREG(s.st_mode);
+        h.truncate_pending = regular and s.st_size != 0;
+
+        // Reserve space without changing the size of the file so we find out now if
+        // there isn’t enough; the hint is ignored if the file system doesn’t support it.
+#    ifdef __linux__
+        if (size_hint and regular and ::fallocate(h.fd, FALLOC_FL_KEEP_SIZE, 0, off_t(size_hint))) {
+            if (errno == ENOSPC or errno == EFBIG or errno == EDQUOT) {
+                error = errno;
+                return {};
+            }
+        }
+#    else
+        (void) size_hint;
+#    endif
+#else
+        (void) size_hint;
+        if (path == "-") {
+            h.f = stdout;
+            return h;
+        }
+
+        // Open existing files without truncating them, unless we can only write to them.
+        h.f = std::fopen(path.data(), "r+b");
+        if (h.f) h.truncate_pending = true;
+        else if (errno == ENOENT or errno == EACCES) h.f = std::fopen(path.data(), "wb");
+        if (not h.f) {
+            error = errno;
+            return {};
+        }
+
+        h.path = path;
+        h.owned = true;
+#endif
+        return h;
+    }
+
+    /// \brief Truncate a file that existed when it was opened.
+    ///
+    /// This happens on the first write or mapping at the latest. Errors are
+    /// reported by \c error() and \c close(), like those of writes.
+    void truncate() {
+        if (not truncate_pending) return;
+        truncate_pending = false;
+#if CLOPTS_USE_MMAP
+        if (::ftruncate(fd, 0)) err = errno;
+#else
+        f = std::freopen(path.c_str(), "wb", f);
+        if (not f) {
+            err = errno;
+            owned = false;
+        }
+#endif
+    }
+
+    /// \brief Close the file.
+    ///
+    /// \return The value of \c errno if any write failed, or 0.
+    int close() {
+        flush();
+#if CLOPTS_USE_MMAP
+        if (mapping) ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+        if (owned and ::close(fd) and not err) err = errno;
+        fd = -1;
+#else
+        if (owned and std::fclose(f) and not err) err = errno ? errno : EIO;
+        f = nullptr;
+#endif
+        owned = false;
+        return err;
+    }
+
+    /// Get the value of \c errno if an operation failed, or 0.
+    [[nodiscard]] int error() const { return err; }
+
+    /// Write the contents of the buffer to the file.
+    void flush() {
+        if (not buffered) return;
+        auto size = buffered;
+        buffered = 0;
+        write_unbuffered(buffer.get(), size);
+    }
+
+    /// \brief Resize the file and map it.
+    ///
+    /// Any previous mapping is unmapped first.
+    ///
+    /// \return The mapping, or an empty span on error.
+    auto map(std::size_t size) -> std::span<std::byte> {
+        flush();
+        truncate();
+        if (err) return {};
+#if CLOPTS_USE_MMAP
+        if (mapping) ::munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+        if (size == 0) {
+            if (::ftruncate(fd, 0)) err = errno;
+            return {};
+        }
+
+        // Allocate the space first; running out of it while writing to the
+        // mapping would crash the program with SIGBUS.
+        if (int e = ::posix_fallocate(fd, 0, off_t(size)); e and e != EOPNOTSUPP and e != EINVAL) err = e;
+        else if (::ftruncate(fd, off_t(size))) err = errno;
+        if (err) return {};
+
+        auto m = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (m == MAP_FAILED) {
+            err = errno;
+            return {};
+        }
+
+        mapping = m;
+        mapping_size = size;
+        return {static_cast<std::byte*>(m), size};
+#else
+        (void) size;
+        err = ENOTSUP;
+        return {};
+#endif
+    }
+
+    /// Write data to the file.
+    void write(const char* data, std::size_t size) {
+        if (err) return;
+        if (buffer and size <= buffer_size - buffered) {
+            std::memcpy(buffer.get() + buffered, data, size);
+            buffered += size;
+        } else {
+            write_slow(data, size);
+        }
+    }
+
+    /// Swap two handles.
+    void swap(output_handle& other) noexcept {
+#if CLOPTS_USE_MMAP
+        std::swap(fd, other.fd);
+        std::swap(mapping, other.mapping);
+        std::swap(mapping_size, other.mapping_size);
+#else
+        std::swap(f, other.f);
+        std::swap(path, other.path);
+#endif
+        std::swap(buffer, other.buffer);
+        std::swap(buffer_size, other.buffer_size);
+        std::swap(buffered, other.buffered);
+        std::swap(err, other.err);
+        std::swap(owned, other.owned);
+        std::swap(truncate_pending, other.truncate_pending);
+    }
+};
+
+/// Open the file of an output_file<> option.
+template <typename output_file_type>
+auto open_output_file(std::string_view path, auto error_handler) -> output_file_type {
+    int error = 0;
+    auto handle = output_handle::open(path, output_file_type::size_hint, output_file_type::buffer_size, error);
+    if (error) {
+        error_handler(parse_error{.kind = error_kind::output_file_error, .argument = path, .error_code = error});
+        return {};
+    }
+
+    return output_file_type{path, std::move(handle)};
+}
+
+/// \brief Check that a file exists and that we can read it, without opening it.
+///
+/// \return 0 if the file can be read, or the value of \c errno otherwise.
+inline int check_file_readable(std::string_view path) {
+#if CLOPTS_USE_MMAP
+    struct stat s {};
+    if (::stat(path.data(), &s) or ::access(path.data(), R_OK)) return errno;
+    if (S_ISDIR(s.st_mode)) return EISDIR;
+    return 0;
+#else
+    std::error_code ec;
+    auto status = std::filesystem::status(path, ec);
+    if (ec) return ec.value();
+    if (std::filesystem::is_directory(status)) return EISDIR;
+    return 0;
+#endif
+}
+
+/// \brief Get the size of a file without opening it.
+///
+/// \return The size, -1 if the file can’t be stat’ed, or -2 if it is a pipe
+/// or socket and its size is only known once it has been read. Devices have
+/// the size the kernel reports for them, as in file_descriptor::size().
+inline auto stat_file_size(std::string_view path) -> std::int64_t {
+#if CLOPTS_USE_MMAP
+    struct stat s {};
+    if (::stat(path.data(), &s)) return -1;
+    return S_ISFIFO(s.st_mode) or S_ISSOCK(s.st_mode) ? -2 : std::int64_t(s.st_size);
+#else
+    std::error_code ec;
+    auto status = std::filesystem::status(path, ec);
+    if (ec) return -1;
+    if (std::filesystem::is_fifo(status) or std::filesystem::is_socket(status)) return -2;
+    if (not std::filesystem::is_regular_file(status)) return 0;
+    auto size = std::filesystem::file_size(path, ec);
+    return ec ? -1 : std::int64_t(size);
+#endif
+}
+
+/// Check the path of a lazy_file<> option; the file is only read once it is accessed.
+template <typename lazy_file_type>
+auto open_lazy_file(std::string_view path, auto error_handler) -> lazy_file_type {
+    if (int error = check_file_readable(path)) {
+        error_handler(parse_error{.kind = error_kind::file_error, .argument = path, .error_code = error});
+        return {};
+    }
+
+    return lazy_file_type{path};
+}
+
+/// \brief A shared pointer that can be replaced while other threads read it.
+///
+/// This uses std::atomic<std::shared_ptr> if the standard library has it,
+/// and a mutex otherwise. Note that the former is not lock-free either in
+/// common implementations (libstdc++ uses the lowest bit of the control block
+/// pointer as a lock), so loads and stores briefly exclude each other either way.
+template <typename type>
+class atomic_shared_ptr {
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<std::shared_ptr<type>> ptr;
+
+public:
+    auto load() const -> std::shared_ptr<type> { return ptr.load(std::memory_order_acquire); }
+    void store(std::shared_ptr<type> p) { ptr.store(std::move(p), std::memory_order_release); }
+#else
+    mutable std::mutex mutex;
+    std::shared_ptr<type> ptr;
+
+public:
+    auto load() const -> std::shared_ptr<type> {
+        std::unique_lock lock{mutex};
+        return ptr;
+    }
+
+    void store(std::shared_ptr<type> p) {
+        std::unique_lock lock{mutex};
+        ptr.swap(p);
+    }
+#endif
+};
+
+/// The part of a watched_file<> that the file watcher knows about.
+struct watched_file_state {
+    std::string path;
+
+    explicit watched_file_state(std::string_view path) : path{path} {}
+    virtual ~watched_file_state() = default;
+
+    /// Read the file again after it has changed.
+    virtual void reload() = 0;
+};
+
+#if CLOPTS_USE_INOTIFY
+/// \brief Watches files for changes on a background thread.
+///
+/// There is one watcher per process, which only starts once the first file is
+/// watched. It watches the directories that contain the files rather than the
+/// files themselves, since many programs replace a file by writing a new one
+/// and renaming it over the old one. Files that are no longer referenced are
+/// forgotten the next time something in their directory changes.
+class file_watcher {
+    struct watch {
+        std::string name;
+        std::weak_ptr<watched_file_state> state;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<int, std::vector<watch>> watches;
+    std::thread thread;
+    int inotify = -1;
+    int wakeup = -1;
+    int init_error = 0;
+
+    file_watcher() {
+        inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (inotify >= 0) wakeup = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (inotify < 0 or wakeup < 0) init_error = errno;
+        else thread = std::thread{[this] { run(); }};
+    }
+
+    ~file_watcher() {
+        if (thread.joinable()) {
+            std::uint64_t one = 1;
+            (void) ::write(wakeup, &one, sizeof one);
+            thread.join();
+        }
+
+        if (inotify >= 0) ::close(inotify);
+        if (wakeup >= 0) ::close(wakeup);
+    }
+
+    /// Collect the files that an event is about.
+    void collect(const inotify_event& e, std::vector<std::shared_ptr<watched_file_state>>& changed) {
+        auto add = [&](std::vector<watch>& files, std::string_view name, bool all) {
+            std::erase_if(files, [&](const watch& w) {
+                auto st = w.state.lock();
+                if (not st) return true;
+                if ((all or w.name == name) and std::ranges::find(changed, st) == changed.end()) changed.push_back(std::move(st));
+                return false;
+            });
+        };
+
+        // If events were dropped, we don’t know what changed.
+        if (e.mask & IN_Q_OVERFLOW) {
+            for (auto& [_, files] : watches) add(files, {}, true);
+            return;
+        }
+
+        auto it = watches.find(e.wd);
+        if (it == watches.end()) return;
+        if (e.mask & IN_IGNORED) {
+            watches.erase(it);
+            return;
+        }
+
+        add(it->second, e.len ? std::string_view{e.name} : std::string_view{}, false);
+        if (it->second.empty()) {
+            ::inotify_rm_watch(inotify, e.wd);
+            watches.erase(it);
+        }
+    }
+
+    void run() {
+        alignas(inotify_event) char buffer[16 * 1024];
+        std::vector<std::shared_ptr<watched_file_state>> changed;
+        for (;;) {
+            std::array fds{pollfd{inotify, POLLIN, 0}, pollfd{wakeup, POLLIN, 0}};
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+
+            if (fds[1].revents) return;
+            auto n = ::read(inotify, buffer, sizeof buffer);
+            if (n <= 0) continue;
+
+            {
+                std::unique_lock lock{mutex};
+                for (auto p = buffer; p < buffer + n;) {
+                    auto& e = *reinterpret_cast<inotify_event*>(p);
+                    p += sizeof(inotify_event) + e.len;
+                    collect(e, changed);
+                }
+            }
+
+            // Reload outside the lock so callbacks can watch more files.
+            for (auto& st : changed) st->reload();
+            changed.clear();
+        }
+    }
+
+public:
+    file_watcher(const file_watcher&) = delete;
+    file_watcher& operator=(const file_watcher&) = delete;
+
+    /// Get the watcher, starting it if this is the first call.
+    static auto instance() -> file_watcher& {
+        static file_watcher watcher;
+        return watcher;
+    }
+
+    /// \brief Start watching a file.
+    ///
+    /// \return 0 on success, or the value of \c errno otherwise.
+    int add(const std::shared_ptr<watched_file_state>& st) {
+        if (init_error) return init_error;
+        std::filesystem::path path{st->path};
+        auto dir = path.parent_path();
+        if (dir.empty()) dir = ".";
+
+        std::unique_lock lock{mutex};
+        int wd = ::inotify_add_watch(inotify, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR);
+        if (wd < 0) return errno;
+        watches[wd].push_back({path.filename().string(), st});
+        return 0;
+    }
+};
+#endif
+
+/// Load a watched_file<> and start watching it.
+template <typename watched_file_type>
+auto open_watched_file(std::string_view path, auto error_handler) -> watched_file_type {
+    watched_file_type file{path};
+    if (int error = file.start()) {
+        error_handler(parse_error{.kind = error_kind::file_error, .argument = path, .error_code = error});
+        return {};
+    }
+
+    return file;
+}
+
+/// Parse an integer or floating-point number.
+///
+/// Unlike std::strtoll() and std::strtod(), this does not depend on the
+/// current locale or on errno, and the string need not be NUL-terminated,
+/// so this can parse any slice of a larger buffer. The entire string must
+/// be a number; an optional leading '+' is allowed, and floating-point
+/// numbers may also be written in hexadecimal, prefixed with '0x'.
+///
+/// \return \c std::errc{} on success, \c std::errc::invalid_argument if
+///         the string is not a number, and \c std::errc::result_out_of_range
+///         if the number is not representable as a \c number_type.
+template <typename number_type>
+auto to_number(std::string_view s, number_type& out) -> std::errc {
+    auto first = s.data();
+    auto last = s.data() + s.size();
+
+    // std::from_chars() doesn’t accept a '+', so skip it, but make sure
+    // it’s not followed by another sign.
+    if (first != last and *first == '+') {
+        if (++first != last and *first == '-') return std::errc::invalid_argument;
+    }
+
+    std::from_chars_result res{};
+    if constexpr (std::is_integral_v<number_type>) {
+        res = std::from_chars(first, last, out, 10);
+    } else {
+        // Check for a hexadecimal number, which std::from_chars() doesn’t
+        // want a prefix for, and handle the sign manually in that case.
+        bool negative = first != last and *first == '-';
+        auto digits = first + negative;
+        if (last - digits > 2 and digits[0] == '0' and (digits[1] == 'x' or digits[1] == 'X')) {
+            if (digits[2] == '-' or digits[2] == '+') return std::errc::invalid_argument;
+            res = std::from_chars(digits + 2, last, out, std::chars_format::hex);
+            if (negative) out = -out;
+        } else {
+            res = std::from_chars(first, last, out, std::chars_format::general);
+        }
+    }
+
+    if (res.ec != std::errc{}) return res.ec;
+    if (res.ptr != last) return std::errc::invalid_argument;
+    return {};
+}
+
+/// Get the name of an option type.
+template <typename t>
+static consteval auto type_name() -> static_string<25> {
+    static_string<25> buffer;
+    if constexpr (detail::is<t, std::string, std::string_view>) buffer.append("string");
+    else if constexpr (detail::is<t, bool>) buffer.append("bool");
+    else if constexpr (detail::is<t, std::int64_t, double>) buffer.append("number");
+    else if constexpr (requires { t::is_file_data; } or requires { t::is_mapped_file; } or requires { t::is_lazy_file; } or requires { t::is_watched_file; } or requires { t::is_stream; } or requires { t::is_lines; } or requires { t::is_output_file; }) buffer.append("file");
+    else if constexpr (detail::is_callback<t>) buffer.append("arg");
+    else if constexpr (detail::is_vector_v<t>) {
+        buffer.append(type_name<typename t::value_type>().arr, type_name<typename t::value_type>().len);
+        buffer.append("s");
+    } else {
+        CLOPTS_ERR("Option type must be std::string, std::string_view, bool, integer, double, or void(*)(), or a vector thereof");
+    }
+    return buffer;
+}
+
+// ===========================================================================
+//  Sort/filter helpers.
+// ===========================================================================
+template <typename opt>
+struct get_option_name {
+    static constexpr std::string_view value = opt::name.sv();
+};
+
+template <typename opt>
+struct is_values_option {
+    static constexpr bool value = opt::is_values;
+};
+
+/// Check if an option is a short option.
+template <typename opt>
+struct is_short_option {
+    static constexpr bool value = requires { opt::is_short; };
+};
+
+/// Check if an option is a regular option.
+template <typename opt>
+struct regular_option {
+    static constexpr bool value = not is<typename opt::canonical_type, special_tag>;
+};
+
+/// Check if an option is a special option.
+template <typename opt>
+struct special_option {
+    static constexpr bool value = not regular_option<opt>::value;
+};
+
+// ===========================================================================
+//  Option Lookup.
+// ===========================================================================
+/// FNV-1a hash of an option name.
+constexpr auto hash_option_name(std::string_view name) -> std::uint64_t {
+    std::uint64_t h = 0xcbf2'9ce4'8422'2325;
+    for (char c : name) {
+        h ^= std::uint8_t(c);
+        h *= 0x100'0000'01b3;
+    }
+    return h;
+}
+
+/// Hash table that maps option names to option indices.
+///
+/// This is built at compile time and uses open addressing with a load
+/// factor of at most 1/2, so looking up a name only takes a hash and,
+/// on average, a single string comparison, irrespective of how many
+/// options there are.
+template <std::size_t count>
+class option_name_table {
+    static constexpr std::size_t capacity = std::bit_ceil(std::max<std::size_t>(count * 2, 2));
+    static constexpr std::size_t mask = capacity - 1;
+
+    /// Option names, by index.
+    std::array<std::string_view, count> names{};
+
+    /// Slots; each slot is an option index + 1, or 0 if empty.
+    std::array<std::size_t, capacity> slots{};
+
+public:
+    /// Build the table. Options for which \c include is false are not
+    /// entered into the table and will never be found.
+    constexpr option_name_table(
+        std::array<std::string_view, count> option_names,
+        std::array<bool, count> include
+    ) : names{option_names} {
+        for (std::size_t i = 0; i < count; i++) {
+            if (not include[i]) continue;
+            auto slot = std::size_t(hash_option_name(names[i])) & mask;
+            while (slots[slot]) slot = (slot + 1) & mask;
+            slots[slot] = i + 1;
+        }
+    }
+
+    /// Get the index of the option with this exact name, or \c count
+    /// if there is no such option.
+    [[nodiscard]] constexpr auto find(std::string_view name) const -> std::size_t {
+        // This always terminates since at least half of the slots are empty.
+        for (auto slot = std::size_t(hash_option_name(name)) & mask;; slot = (slot + 1) & mask) {
+            auto index = slots[slot];
+            if (index == 0) return count;
+            if (names[index - 1] == name) return index - 1;
+        }
+    }
+};
+
+/// Count the number of trie nodes needed to store a sorted list of names.
+template <std::size_t name_count>
+constexpr auto count_trie_nodes(const std::array<std::pair<std::string_view, std::size_t>, name_count>& names) -> std::size_t {
+    // Each name adds a node for every character that is not part of
+    // the prefix it shares with the name before it.
+    std::size_t count = 1;
+    for (std::size_t i = 0; i < name_count; i++) {
+        std::size_t common = 0;
+        if (i != 0) {
+            auto a = names[i - 1].first, b = names[i].first;
+            while (common < a.size() and common < b.size() and a[common] == b[common]) common++;
+        }
+        count += names[i].first.size() - common;
+    }
+    return count;
+}
+
+/// Character trie over option names.
+///
+/// This is used to find the longest option name that is a prefix of an
+/// argument, which is what we need for short options and --option=value;
+/// the number of steps this takes depends only on the length of the
+/// argument, not on the number of options.
+template <std::size_t name_count, std::size_t node_count>
+class option_name_trie {
+    struct node {
+        std::uint32_t first_edge{};
+        std::uint32_t edge_count{};
+        std::size_t option{}; ///< Option index + 1, or 0 if no name ends here.
+    };
+
+    struct edge {
+        unsigned char c{};
+        std::uint32_t target{};
+    };
+
+    std::array<node, node_count> nodes{};
+    std::array<edge, node_count - 1> edges{};
+    std::uint32_t nodes_used = 1;
+    std::uint32_t edges_used = 0;
+
+    /// Create the subtrie for names[lo, hi), all of which share the first
+    /// \c depth characters.
+    template <typename names_type>
+    constexpr void build(const names_type& names, std::size_t lo, std::size_t hi, std::size_t depth, std::uint32_t n) {
+        // A name that ends here sorts before all other names in this range.
+        if (lo < hi and names[lo].first.size() == depth) nodes[n].option = names[lo++].second + 1;
+
+        // Count the distinct characters that follow.
+        std::uint32_t count = 0;
+        for (std::size_t i = lo; i < hi; i++)
+            if (i == lo or names[i].first[depth] != names[i - 1].first[depth])
+                count++;
+
+        // Allocate the edges first so they're contiguous, then recurse.
+        nodes[n].first_edge = edges_used;
+        nodes[n].edge_count = count;
+        edges_used += count;
+        for (std::uint32_t e = nodes[n].first_edge; lo < hi; e++) {
+            auto c = names[lo].first[depth];
+            auto end = lo;
+            while (end < hi and names[end].first[depth] == c) end++;
+            edges[e] = {static_cast<unsigned char>(c), nodes_used++};
+            build(names, lo, end, depth + 1, edges[e].target);
+            lo = end;
+        }
+    }
+
+public:
+    /// Build the trie from a list of option names and indices, which must
+    /// be sorted by name.
+    constexpr option_name_trie(const std::array<std::pair<std::string_view, std::size_t>, name_count>& names) {
+        build(names, 0, name_count, 0, 0);
+    }
+
+    /// Find the longest option name that is a prefix of \c str and for
+    /// which \c accept(index, length) returns true.
+    ///
+    /// \return The index of that option, or \c -1 if there is none.
+    [[nodiscard]] constexpr auto longest_prefix(std::string_view str, auto accept) const -> std::size_t {
+        std::size_t found = std::size_t(-1);
+        for (std::uint32_t n = 0, i = 0;; i++) {
+            if (nodes[n].option and accept(nodes[n].option - 1, std::size_t(i))) found = nodes[n].option - 1;
+            if (i == str.size()) return found;
+
+            // Find the edge for the next character.
+            auto first = edges.begin() + nodes[n].first_edge;
+            auto last = first + nodes[n].edge_count;
+            auto c = static_cast<unsigned char>(str[i]);
+            auto it = std::lower_bound(first, last, c, [](const edge& e, unsigned char ch) { return e.c < ch; });
+            if (it == last or it->c != c) return found;
+            n = it->target;
+        }
+    }
+};
+
+// ===========================================================================
+//  Storage Policies.
+// ===========================================================================
+/// Map a type used to store option values to the equivalent type that
+/// allocates using a std::pmr::memory_resource.
+template <typename t>
+struct pmr_rebind {
+    using type = t;
+};
+
+template <typename t>
+using pmr_rebind_t = typename pmr_rebind<t>::type;
+
+template <>
+struct pmr_rebind<std::string> {
+    using type = std::pmr::string;
+};
+
+template <typename element>
+struct pmr_rebind<std::vector<element>> {
+    using type = std::pmr::vector<pmr_rebind_t<element>>;
+};
+
+template <typename element>
+struct pmr_rebind<std::optional<element>> {
+    using type = std::optional<pmr_rebind_t<element>>;
+};
+
+template <typename... elements>
+struct pmr_rebind<std::tuple<elements...>> {
+    using type = std::tuple<pmr_rebind_t<elements>...>;
+};
+
+template <typename file_type>
+requires requires { file_type::is_file_data; }
+struct pmr_rebind<file_type> {
+    using type = typename file_type::template rebind_contents<pmr_rebind_t<typename file_type::contents_type>>;
+};
+
+/// Store option values using the default allocator.
+struct default_storage {
+    using allocator_type = std::allocator<char>;
+    template <typename type> using rebind = type;
+};
+
+/// Store option values using a std::pmr::memory_resource.
+struct pmr_storage {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    template <typename type> using rebind = pmr_rebind_t<type>;
+};
+
+// ===========================================================================
+//  Main Implementation.
+// ===========================================================================
+template <typename... opts>
+class clopts_impl;
+
+template <typename... opts, typename... special, typename storage_policy>
+class clopts_impl<list<opts...>, list<special...>, storage_policy> {
+    using allocator_type = typename storage_policy::allocator_type;
+    static constexpr bool uses_memory_resource = std::is_same_v<storage_policy, pmr_storage>;
+
+    // This should never be instantiated by the user.
+    explicit clopts_impl(const allocator_type& alloc) : optvals{alloc}, spare_values{std::allocator_arg, alloc}, allocator{alloc} {}
+    ~clopts_impl() = default;
+    clopts_impl(const clopts_impl& o) = delete;
+    clopts_impl(clopts_impl&& o) = delete;
+    clopts_impl& operator=(const clopts_impl& o) = delete;
+    clopts_impl& operator=(clopts_impl&& o) = delete;
+
+    // =======================================================================
+    //  Option Access by Name.
+    // =======================================================================
+    /// Option names.
+    static constexpr std::array<const char*, sizeof...(opts)> opt_names{opts::name.arr...};
+
+    /// Get the index of an option.
+    template <size_t index, static_string option>
+    static constexpr size_t optindex_impl() {
+        if constexpr (index >= sizeof...(opts)) return index;
+        else if constexpr (CLOPTS_STRCMP(opt_names[index], option.arr) == 0) return index;
+        else return optindex_impl<index + 1, option>();
+    }
+
+#if __cpp_static_assert >= 202306L
+    template <static_string option>
+    static consteval auto format_invalid_option_name() -> static_string<option.size() + 45> {
+        static_string<option.size() + 45> ret;
+        ret.append("There is no option with the name '");
+        ret.append(option.data(), option.size());
+        ret.append("'");
+        return ret;
+    }
+#endif
+
+    template <bool ok, static_string option>
+    static consteval void assert_valid_option_name() {
+#if __cpp_static_assert >= 202306L
+        static_assert(ok, format_invalid_option_name<option>());
+#else
+        static_assert(ok, "Invalid option name. You've probably misspelt an option.");
+#endif
+    }
+
+    /// Get the index of an option and raise an error if the option is not found.
+    template <static_string option>
+    static constexpr size_t optindex() {
+        constexpr size_t sz = optindex_impl<0, option>();
+        assert_valid_option_name<(sz < sizeof...(opts)), option>();
+        return sz;
+    }
+
+    /// Get an option by name.
+    // TODO: Use pack indexing once the syntax is fixed and compilers
+    // have actually started defining __cpp_pack_indexing.
+    template <static_string name>
+    using opt_by_name = nth_type<optindex<name>(), opts...>;
+
+    // I hate not having pack indexing.
+    template <std::size_t i, static_string str, static_string... strs>
+    static constexpr auto nth_str() {
+        if constexpr (i == 0) return str;
+        else return nth_str<i - 1, strs...>();
+    }
+
+    // =======================================================================
+    //  Validation.
+    // =======================================================================
+    static_assert(sizeof...(opts) > 0, "At least one option is required");
+
+    /// Make sure no two options have the same name.
+    static consteval bool check_duplicate_options() {
+        // State is ok initially.
+        bool ok = true;
+        std::size_t i = 0;
+
+        // Iterate over each option for each option.
+        While<opts...>(ok, [&]<typename opt>() {
+            std::size_t j = 0;
+            While<opts...>(ok, [&]<typename opt2>() {
+                // If the options are not the same, but their names are the same
+                // then this is an error. Iteration will stop at this point because
+                // \c ok is also the condition for the two loops.
+                ok = i == j or opt::name != opt2::name;
+                j++;
+            });
+            i++;
+        });
+
+        // Return whether everything is ok.
+        return ok;
+    }
+
+    // This check is currently broken on MSVC 19.38 and later, for some reason.
+#if !defined(_MSC_VER) || defined(__clang__) || _MSC_VER < 1938
+    /// Make sure that no option has a prefix that is a short option.
+    static consteval bool check_short_opts() {
+        // State is ok initially.
+        bool ok = true;
+        std::size_t i = 0;
+
+        // Iterate over each option for each option.
+        While<opts...>(ok, [&]<typename opt>() {
+            std::size_t j = 0;
+            While<opts...>(ok, [&]<typename opt2>() {
+                // Check the condition.
+                ok = i == j or not requires { opt::is_short; } or not opt2::name.sv().starts_with(opt::name.sv());
+                j++;
+            });
+            i++;
+        });
+
+        // Return whether everything is ok.
+        return ok;
+    }
+
+    static_assert(check_short_opts(), "Option name may not start with the name of a short option");
+#endif
+
+    /// Make sure there is at most one multiple<positional<>> option.
+    static consteval size_t validate_multiple() {
+        auto is_mul = []<typename opt>() { return requires { opt::is_multiple; }; };
+        return (... + (is_mul.template operator()<opts>() and detail::is_positional_v<opts>) );
+    }
+
+    template <typename type, static_string... references>
+    static consteval bool validate_references_impl(ref<type, references...>) { // clang-format off
+        auto ValidateReference = []<static_string str>() {
+            return ((
+                // Name must reference an existing option.
+                opts::name == str and
+                // And that option must not also be a ref<> option; this is to
+                // prevent cycles.
+                not opts::is_ref
+            ) or ...);
+        };
+        return (ValidateReference.template operator()<references>() and ...);
+    } // clang-format on
+
+    /// Make sure all referenced values exist.
+    static consteval bool validate_references() {
+        bool ok = true;
+        While<opts...>(ok, [&]<typename opt> {
+            using type = typename opt::declared_type_base;
+            if constexpr (opt::is_ref) ok = validate_references_impl(type{});
+        });
+        return ok;
+    }
+
+    /// Check whether a ref<> type references an option.
+    template <static_string name, typename type, static_string... references>
+    static consteval bool references_option(ref<type, references...>) {
+        return ((name == references) or ...);
+    }
+
+    /// Check whether any ref<> option references an option.
+    template <static_string name>
+    static consteval bool is_referenced() {
+        bool referenced = false;
+        Foreach<opts...>([&]<typename opt> {
+            using type = typename opt::declared_type_base;
+            if constexpr (opt::is_ref) referenced = referenced or references_option<name>(type{});
+        });
+        return referenced;
+    }
+
+    /// Make sure we don’t have invalid option combinations.
+    static_assert(check_duplicate_options(), "Two different options may not have the same name");
+    static_assert(validate_multiple() <= 1, "Cannot have more than one multiple<positional<>> option");
+    static_assert(validate_references(), "All options with a ref<> type must reference an existing non-ref option");
+
+    // =======================================================================
+    //  Option Storage.
+    // =======================================================================
+    template <typename opt>
+    struct storage_type;
+
+    template <typename opt>
+    using storage_type_t = typename storage_type<opt>::type;
+
+    template <typename opt>
+    using single_element_storage_type_t = remove_vector_t<storage_type_t<opt>>;
+
+    template <typename, typename>
+    struct compute_ref_storage_type {
+        // Needed so we can instantiate this with an invalid type, even
+        // though we never actually use it (yes, there are other ways
+        // around this but I can’t be bothered).
+        using type = void;
+    };
+
+    /// The type used to store a (possibly empty) copy of an option type.
+    template <typename opt>
+    using ref_storage_type_t = // clang-format off
+        // For flags, just store a bool.
+        std::conditional_t<is_same<storage_type_t<opt>, bool>, bool,
+        // For multiple<> options, store a vector, because we need to deep-copy the state.
+        std::conditional_t<is_vector_v<storage_type_t<opt>>, storage_type_t<opt>,
+        // Otherwise, store an optional, since the value may be empty.
+        std::optional<storage_type_t<opt>>
+    >>; // clang-format on
+
+    /// The type used to store a snapshot of an option.
+    template <typename opt>
+    using snapshot_storage_type_t = // clang-format off
+        // For multiple<> options, store how many values there were.
+        std::conditional_t<is_vector_v<storage_type_t<opt>>, std::size_t,
+        // Flags and options that can only be set once don’t change after they’ve been
+        // found, so we only need to know whether they were.
+        std::conditional_t<is_same<storage_type_t<opt>, bool> or not opt::is_overridable, bool,
+        // Overridable options can change later, so those still need a copy.
+        std::optional<storage_type_t<opt>>
+    >>; // clang-format on
+
+    template <typename declared_type, typename declared_type_base, static_string... args>
+    struct compute_ref_storage_type<declared_type, ref<declared_type_base, args...>> { // clang-format off
+        using tuple = std::tuple<
+            option_type_t<declared_type_base>,
+            ref_storage_type_t<opt_by_name<args>>...
+        >;
+
+        using type = std::conditional_t<is_vector_v<declared_type>, std::vector<tuple>, tuple>;
+    }; // clang-format on
+
+    template <typename declared_type, typename declared_type_base, static_string... args>
+    struct compute_ref_storage_type<declared_type, snapshot_ref<declared_type_base, args...>> { // clang-format off
+        using tuple = std::tuple<
+            option_type_t<declared_type_base>,
+            snapshot_storage_type_t<opt_by_name<args>>...
+        >;
+
+        using type = std::conditional_t<is_vector_v<declared_type>, std::vector<tuple>, tuple>;
+    }; // clang-format on
+
+    /// Helper to determine the type used to store an option value.
+    ///
+    /// This is usually just the canonical type, but for options that
+    /// reference other options, we need to add all the references as
+    /// well.
+    template <typename opt>
+    struct storage_type {
+        using type = typename storage_policy::template rebind<typename std::conditional_t<
+            opt::is_ref,
+            compute_ref_storage_type<typename opt::declared_type, typename opt::declared_type_base>,
+            std::type_identity<typename opt::canonical_type>
+        >::type>;
+    };
+
+    /// The type of a single value of an option, before references are added.
+    template <typename opt>
+    using value_type_t = typename storage_policy::template rebind<typename opt::single_element_type>;
+
+    /// The type returned to the user by 'get<>().
+    template <typename opt>
+    using get_return_type = // clang-format off
+        // For flags, just return a bool.
+        std::conditional_t<is_same<typename opt::canonical_type, bool>, bool,
+        // For multiple<> options, return a span.
+        std::conditional_t<is_vector_v<storage_type_t<opt>>, std::span<single_element_storage_type_t<opt>>,
+        // Otherwise, return a pointer.
+        storage_type_t<opt>*
+    >>; // clang-format on
+
+    /// Various types.
+    using help_string_t = static_string<1024 + 1024 * sizeof...(opts)>; // Size should be ‘big enough’™.
+    using optvals_tuple_t = std::tuple<storage_type_t<opts>...>;
+    using string = std::string;
+    using integer = int64_t;
+
+    static constexpr bool has_stop_parsing = (requires { special::is_stop_parsing; } or ...);
+    static constexpr bool has_defer_overrides = (requires { special::is_defer_overrides; } or ...);
+    static constexpr bool has_dedupe_files = (requires { special::is_dedupe_files; } or ...) and CLOPTS_USE_MMAP;
+    static constexpr bool has_file_budget = (requires { special::file_budget_bytes; } or ...);
+    static constexpr bool has_response_files = (requires { special::response_file_depth; } or ...);
+
+    /// How deeply response files may be nested.
+    static constexpr std::size_t response_file_depth = [] {
+        std::size_t depth = 0;
+        Foreach<special...>([&]<typename s> {
+            if constexpr (requires { s::response_file_depth; }) depth = s::response_file_depth;
+        });
+        return depth;
+    }();
+
+    /// The maximum number of bytes that file<> options may load in total.
+    static constexpr std::size_t file_budget_bytes = [] {
+        std::size_t bytes = 0;
+        Foreach<special...>([&]<typename s> {
+            if constexpr (requires { s::file_budget_bytes; }) bytes = s::file_budget_bytes;
+        });
+        return bytes;
+    }();
+
+    /// \brief Whether the conversion of an option’s value is deferred until the end of parsing.
+    ///
+    /// If so, only the last occurrence of the option is converted. This can’t be done for
+    /// options that are referenced by a ref<>, since a ref<> captures the value the
+    /// option has at the point where the ref<> option is encountered.
+    template <typename opt>
+    static constexpr bool defer_conversion = has_defer_overrides and
+                                             opt::is_overridable and
+                                             not requires { opt::is_multiple; } and
+                                             not detail::is_callback<typename opt::canonical_type> and
+                                             detail::has_argument<typename opt::canonical_type> and
+                                             not is_referenced<opt::name>();
+
+    /// \brief Whether file<> options are loaded on several threads.
+    ///
+    /// Memory resources are generally not thread-safe, so this is disabled for
+    /// pmr::clopts. Options that are referenced by or that are ref<>s need the
+    /// file contents during the scan, so they are always loaded immediately.
+    static constexpr bool has_parallel_file_loading = (requires { special::file_loading_threads; } or ...) and not uses_memory_resource;
+
+    template <typename opt>
+    static constexpr bool load_in_parallel = has_parallel_file_loading and
+                                             requires { opt::single_element_type::is_file_data; } and
+                                             not opt::is_ref and
+                                             not is_referenced<opt::name>();
+
+    /// \brief Whether the values of an option are converted into existing values.
+    ///
+    /// Strings are assigned, and files are read into the contents of the previous
+    /// value, so parsing into the same option values again reuses their memory.
+    /// Files that dedupe_files hands out are copies, so they can’t be reused.
+    template <typename opt>
+    static constexpr bool converts_in_place = not opt::is_ref and (
+        detail::is<typename opt::single_element_type, std::string> or
+        (requires { opt::single_element_type::is_file_data; } and (not has_dedupe_files or load_in_parallel<opt>))
+    );
+
+    /// Whether we keep the values of a multiple<> option between parses so we can convert into them.
+    template <typename opt>
+    static constexpr bool reuses_elements = is_vector_v<storage_type_t<opt>> and converts_in_place<opt>;
+
+    /// Storage for the values of a multiple<> option that we’re keeping for the next parse.
+    template <typename opt>
+    using spare_storage_t = std::conditional_t<reuses_elements<opt>, storage_type_t<opt>, empty>;
+
+    /// The maximum number of threads to load files on; 0 means one per core.
+    static constexpr std::size_t file_loading_threads = [] {
+        std::size_t threads = 0;
+        Foreach<special...>([&]<typename s> {
+            if constexpr (requires { s::file_loading_threads; }) threads = s::file_loading_threads;
+        });
+        return threads;
+    }();
+
+    /// A file that will be loaded once all arguments have been processed.
+    struct pending_file {
+        void (clopts_impl::*load)(pending_file&);
+        void* (clopts_impl::*prepare)(pending_file&, std::size_t);
+        std::string_view option;
+        std::string_view path;
+        std::size_t option_index;
+        std::size_t element;
+        std::int64_t size;
+        int argument_index;
+        int error;
+        bool multiple;
+        bool skip;
+        bool loaded;
+        bool over_budget;
+    };
+
+    /// \brief A file that was loaded earlier during this parse.
+    ///
+    /// Mappings are shared between all options. The contents of file<> options
+    /// are kept in a single immutable buffer that every later occurrence is
+    /// copied from; \c contents_kind tells us what type they have, since two
+    /// options may load the same file differently.
+    struct cached_file {
+        std::optional<detail::file_mapping> mapping;
+        std::shared_ptr<const void> contents;
+        const void* contents_kind{};
+    };
+
+    /// Identifies a contents type and read strategy for cached_file.
+    template <typename contents_type, typename read_strategy>
+    static constexpr char contents_kind{};
+
+    /// Identifies a response file so we can tell if it includes itself.
+#if CLOPTS_USE_MMAP
+    using response_file_id = std::optional<detail::file_identity>;
+    static auto identify_response_file(std::string_view path) -> response_file_id {
+        return detail::file_identity::of(path);
+    }
+#else
+    using response_file_id = std::optional<std::filesystem::path>;
+    static auto identify_response_file(std::string_view path) -> response_file_id {
+        std::error_code ec;
+        auto canonical = std::filesystem::canonical(path, ec);
+        if (ec) return std::nullopt;
+        return canonical;
+    }
+#endif
+
+    /// A response file that we’re reading arguments from.
+    struct response_file {
+        detail::argument_tokenizer arguments;
+        response_file_id id;
+    };
+
+    /// Arguments after the stop_parsing<> option that aren’t in argv.
+    struct unprocessed_args_storage {
+        std::vector<const char*> args;
+        detail::string_copies copies;
+    };
+
+    /// The last occurrence of an option whose conversion is deferred.
+    struct deferred_value {
+        std::string_view option;
+        std::string_view value;
+        int argument_index;
+    };
+
+public:
+    using error_handler_t = std::function<bool(std::string&&)>;
+
+    // =======================================================================
+    //  Option Access.
+    // =======================================================================
+    /// Result type.
+    class optvals_type {
+        friend clopts_impl;
+        optvals_tuple_t optvals{};
+        std::bitset<sizeof...(opts)> opts_found{};
+        std::conditional_t<has_stop_parsing, std::span<const char*>, empty> unprocessed_args{};
+        std::conditional_t<has_stop_parsing, std::shared_ptr<unprocessed_args_storage>, empty> unprocessed_storage{};
+
+        /// Arguments read from a response file point into its mapping, so it
+        /// has to live as long as the option values.
+        std::conditional_t<has_response_files, std::vector<detail::file_mapping>, empty> response_files{};
+
+        /// Arguments split from a single string point into a copy of it.
+        detail::command_line_buffer command_line{};
+
+        /// Construct the option values using an allocator.
+        explicit optvals_type(const allocator_type& alloc) : optvals{std::allocator_arg, alloc} {}
+
+        // This implements get<>() and get_or<>().
+        template <static_string s>
+        constexpr auto get_impl() -> get_return_type<opt_by_name<s>> {
+            using canonical = typename opt_by_name<s>::canonical_type;
+
+            // Bool options don’t have a value. Instead, we just return whether the option was found.
+            if constexpr (std::is_same_v<canonical, bool>) return opts_found[optindex<s>()];
+
+            // We always return a span to multiple<> options because the user can just check if it’s empty.
+            else if constexpr (detail::is_vector_v<canonical>) return std::get<optindex<s>()>(optvals);
+
+            // Function options don’t have a value.
+            else if constexpr (detail::is_callback<canonical>) CLOPTS_ERR("Cannot call get<>() on an option with function type.");
+
+            // Otherwise, return nullptr if the option wasn’t found, and a pointer to the value otherwise.
+            else return not opts_found[optindex<s>()] ? nullptr : std::addressof(std::get<optindex<s>()>(optvals));
+        }
+
+        // Turn a snapshot of an option into a bool, span, or pointer.
+        template <static_string name>
+        auto resolve_snapshot(const auto& snapshot) const {
+            using opt = opt_by_name<name>;
+            const auto& storage = std::get<optindex<name>()>(optvals);
+            if constexpr (opt::is_flag) return bool(snapshot);
+            else if constexpr (is_vector_v<storage_type_t<opt>>) return std::span{storage.data(), snapshot};
+            else if constexpr (not opt::is_overridable) return snapshot ? std::addressof(storage) : nullptr;
+            else return snapshot ? std::addressof(*snapshot) : nullptr;
+        }
+
+        // Resolve all snapshots in the value of a snapshot_ref<> option.
+        template <typename type, static_string... args>
+        auto resolve_snapshots(const auto& tuple, ref<type, args...>) const {
+            using value_type = std::tuple_element_t<0, std::remove_cvref_t<decltype(tuple)>>;
+            return [&]<std::size_t... i>(std::index_sequence<i...>) {
+                return std::tuple<const value_type&, decltype(resolve_snapshot<args>(std::get<i + 1>(tuple)))...>{
+                    std::get<0>(tuple),
+                    resolve_snapshot<args>(std::get<i + 1>(tuple))...,
+                };
+            }(std::make_index_sequence<sizeof...(args)>());
+        }
+
+        // This implements get<>() for snapshot_ref<> options.
+        template <static_string s>
+        auto get_snapshot() const {
+            using opt = opt_by_name<s>;
+            const auto& storage = std::get<optindex<s>()>(optvals);
+            auto resolve = [this](const auto& tuple) {
+                return resolve_snapshots(tuple, typename opt::declared_type_base{});
+            };
+
+            // Resolve multiple<> options lazily, one element at a time.
+            if constexpr (detail::is_vector_v<typename opt::canonical_type>) return storage | std::views::transform(resolve);
+            else return opts_found[optindex<s>()] ? std::optional{resolve(storage)} : std::nullopt;
+        }
+
+    public:
+        optvals_type() = default;
+
+        /// \brief Get the value of an option.
+        ///
+        /// This is not \c [[nodiscard]] because that raises an ICE when compiling
+        /// with some older versions of GCC.
+        ///
+        /// \return \c true / \c false if the option is a flag
+        /// \return \c nullptr if the option was not found
+        /// \return a pointer to the value if the option was found
+        ///
+        /// \see get_or()
+        template <static_string s>
+        constexpr auto get() {
+            // Check if the option exists before calling get_impl<>() so we trigger the static_assert
+            // below before hitting a complex template instantiation error.
+            constexpr auto sz = optindex_impl<0, s>();
+            if constexpr (sz >= sizeof...(opts)) assert_valid_option_name<(sz < sizeof...(opts)), s>();
+            else if constexpr (opt_by_name<s>::is_snapshot_ref) return get_snapshot<s>();
+            else return get_impl<s>();
+        }
+
+        /// \brief Get the value of an option or a default value if the option was not found.
+        ///
+        /// The default value is \c static_cast to the type of the option value.
+        ///
+        /// \param default_ The default value to return if the option was not found.
+        /// \return \c default_ if the option was not found.
+        /// \return a copy of the option value if the option was found.
+        ///
+        /// \see get()
+        template <static_string s>
+        constexpr auto get_or(auto default_) {
+            constexpr auto sz = optindex_impl<0, s>();
+            if constexpr (sz < sizeof...(opts)) {
+                if (opts_found[optindex<s>()]) return *get_impl<s>();
+                return static_cast<std::remove_cvref_t<decltype(*get_impl<s>())>>(default_);
+            } else {
+                assert_valid_option_name<(sz < sizeof...(opts)), s>();
+            }
+        }
+
+        /// \brief Get unprocessed options.
+        ///
+        /// If the \c stop_parsing\<> option was encountered, this will return the
+        /// remaining options that have not been processed by this parser. If there
+        /// is no \c stop_parsing\<> option, this will always return an empty span.
+        ///
+        /// If there was an error during parsing, the return value of this function
+        /// is unspecified.
+        [[nodiscard]] auto unprocessed() const -> std::span<const char*> {
+            if constexpr (has_stop_parsing) return unprocessed_args;
+            else return {};
+        }
+    };
+
+private:
+    // =======================================================================
+    //  Parser State.
+    // =======================================================================
+    /// Variables for the parser and for storing parsed options.
+    optvals_type optvals;
+    std::tuple<spare_storage_t<opts>...> spare_values;
+    bool has_error = false;
+
+    /// Whether any error was reported, even if the error handler let us continue.
+    bool error_reported = false;
+    int argc{};
+    int argi{};
+    std::size_t positional_cursor{};
+    const char** argv{};
+    detail::argument_source source{};
+    std::string_view program{};
+    detail::string_copies path_copies{};
+    bool args_terminated = true;
+    void* user_data{};
+    error_handler_ref error_handler{};
+    [[no_unique_address]] allocator_type allocator;
+    [[no_unique_address]] std::conditional_t<
+        has_defer_overrides,
+        std::array<deferred_value, sizeof...(opts)>,
+        empty>
+        deferred_values{};
+    [[no_unique_address]] std::conditional_t<
+        has_parallel_file_loading,
+        std::vector<pending_file>,
+        empty>
+        pending_files{};
+#if CLOPTS_USE_MMAP
+    [[no_unique_address]] std::conditional_t<
+        has_dedupe_files,
+        std::unordered_map<detail::file_identity, cached_file, detail::file_identity::hash>,
+        empty>
+        file_cache{};
+#endif
+    [[no_unique_address]] std::conditional_t<
+        has_file_budget,
+        std::size_t,
+        empty>
+        file_budget_used{};
+    [[no_unique_address]] std::conditional_t<
+        has_response_files,
+        std::vector<response_file>,
+        empty>
+        response_file_stack{};
+
+    // =======================================================================
+    //  Helpers.
+    // =======================================================================
+    /// Error handler that is used if the user doesn’t provide one.
+    bool default_error_handler(const parse_error& error) {
+        auto name = program_name();
+        if (not name.empty()) std::cerr << name << ": ";
+        std::cerr << error.message() << "\n";
+
+        // Invoke the help option.
+        bool invoked = false;
+        auto invoke = [&]<typename opt> {
+            if constexpr (requires { opt::is_help_option; }) {
+                invoked = true;
+                invoke_help_callback<opt>();
+            }
+        };
+
+        // If there is a help option, invoke it.
+        (invoke.template operator()<opts>(), ...);
+
+        // If no help option was found, print the help message.
+        if (not invoked) {
+            std::cerr << "Usage: ";
+            if (not name.empty()) std::cerr << name << " ";
+            std::cerr << help();
+        }
+
+        std::exit(1);
+    }
+
+    /// Invoke the error handler and set the error flag.
+    void handle_error(parse_error error) {
+        // Errors about missing options aren’t about any argument in particular.
+        if (error.argument_index == -1 and error.kind != error_kind::missing_required_option)
+            error.argument_index = argi;
+
+        // Dispatch the error.
+        error_reported = true;
+        has_error = not(error_handler ? error_handler(error) : default_error_handler(error));
+    }
+
+    /// Invoke the help callback of the help option.
+    template <typename opt>
+    void invoke_help_callback() {
+        // New API: program name + help message [+ user data].
+        using sv = std::string_view;
+        if constexpr (requires { opt::help_callback(sv{}, sv{}, user_data); })
+            opt::help_callback(sv{program_name()}, sv{}, user_data);
+        else if constexpr (requires { opt::help_callback(sv{}, sv{}); })
+            opt::help_callback(sv{program_name()}, help_message_raw.sv());
 
         // Compatibility for callbacks that don’t take the program name.
         else if constexpr (requires { opt::help_callback(sv{}, user_data); })
@@ -1089,527 +3159,1627 @@ private:
         else if constexpr (requires { opt::help_callback(sv{}); })
             opt::help_callback(help_message_raw.sv());
 
-        // Invalid help option callback.
-        else static_assert(
-            detail::always_false<opt>,
-            "Invalid help option signature. Consult the README for more information"
-        );
+        // Invalid help option callback.
+        else static_assert(
+            detail::always_false<opt>,
+            "Invalid help option signature. Consult the README for more information"
+        );
+    }
+
+    /// Helper to parse an integer or double.
+    template <typename opt, typename number_type, static_string name>
+    auto parse_number(std::string_view s) -> number_type {
+        number_type i{};
+        parse_error error{
+            .option = opt::name.sv(),
+            .argument = s,
+            .expected = name.sv(),
+            .option_index = optindex<opt::name>(),
+        };
+
+        // The empty string is a valid integer *and* float, apparently.
+        if (s.empty()) {
+            error.kind = error_kind::empty_number;
+            handle_error(error);
+            return i;
+        }
+
+        // Parse the number.
+        auto ec = detail::to_number(s, i);
+        if (ec == std::errc{}) return i;
+        error.kind = ec == std::errc::result_out_of_range ? error_kind::number_out_of_range : error_kind::invalid_number;
+        handle_error(error);
+        return i;
+    }
+
+    /// Get the program name, if available.
+    auto program_name() const -> std::string_view {
+        if (argv) return argv[0];
+        return program;
+    }
+
+    // =======================================================================
+    //  Internal Option Access.
+    // =======================================================================
+    /// Check if an option was found.
+    template <static_string option>
+    bool found() { return optvals.opts_found[optindex<option>()]; }
+
+    /// Get a reference to an option value.
+    template <static_string s>
+    [[nodiscard]] constexpr auto ref_to_storage() -> decltype(std::get<optindex<s>()>(optvals.optvals))& {
+        using value_type = decltype(std::get<optindex<s>()>(optvals.optvals));
+
+        // Bool options don’t have a value.
+        if constexpr (std::is_same_v<value_type, bool>) CLOPTS_ERR("Cannot call ref() on an option<bool>");
+
+        // Function options don’t have a value.
+        else if constexpr (detail::is_callback<value_type>) CLOPTS_ERR("Cannot call ref<>() on an option with function type.");
+
+        // Get the option value.
+        else return std::get<optindex<s>()>(optvals.optvals);
+    }
+
+    /// Mark an option as found.
+    template <static_string option>
+    void set_found() { optvals.opts_found[optindex<option>()] = true; }
+
+    /// Store an option value.
+    template <bool is_multiple>
+    void store_option_value(auto& ref, auto value) {
+        // Set the value.
+        if constexpr (is_multiple) ref.push_back(std::move(value));
+
+        // Replace the value instead of assigning to it; values that aren’t allocator-aware
+        // themselves (e.g. file<>) are not constructed with our allocator, so assigning to
+        // them would copy the parts that are rather than take ownership of them.
+        else {
+            std::destroy_at(std::addressof(ref));
+            std::construct_at(std::addressof(ref), std::move(value));
+        }
+    }
+
+    /// Copy a value such that the copy uses our allocator.
+    template <typename type>
+    auto copy_value(const type& value) -> type {
+        if constexpr (requires { type::is_file_data; }) return type{value.path, copy_value(value.contents)};
+        else if constexpr (requires { type::is_stream; }) static_assert(always_false<type>, "stream<> options can only be referenced by snapshot_ref<>");
+        else if constexpr (requires { type::is_output_file; }) static_assert(always_false<type>, "output_file<> options can only be referenced by snapshot_ref<>");
+        else return std::make_obj_using_allocator<type>(allocator, value);
+    }
+
+    // =======================================================================
+    //  Help Message.
+    // =======================================================================
+    /// Create the help message.
+    static constexpr auto make_help_message() -> help_string_t { // clang-format off
+        using positional_unsorted = filter<is_positional, opts...>;
+        using positional = sort<get_option_name, positional_unsorted>;
+        using non_positional = sort<get_option_name, filter<is_not_positional, opts...>>;
+        using values_opts = sort<get_option_name, filter<is_values_option, opts...>>;
+        help_string_t msg{};
+
+        // Append the positional options.
+        //
+        // Do NOT sort them here as this is where we print in what order
+        // they’re supposed to appear in, so sorting would be very stupid
+        // here.
+        bool have_positional_opts = false;
+        positional_unsorted::each([&]<typename opt> {
+            have_positional_opts = true;
+            if (not opt::is_required) msg.append("[");
+            msg.append("<");
+            msg.append(opt::name.arr, opt::name.len);
+            msg.append(">");
+            if (not opt::is_required) msg.append("]");
+            msg.append(" ");
+        });
+
+        // End of first line.
+        msg.append("[options]\n");
+
+        // Determine the length of the longest name + typename so that
+        // we know how much padding to insert before actually printing
+        // the description. Also factor in the <> signs around and the
+        // space after the option name, as well as the type name.
+        size_t max_vals_opt_name_len{};
+        size_t max_len{};
+        Foreach<opts...>([&]<typename opt> {
+            if constexpr (opt::is_values)
+                max_vals_opt_name_len = std::max(max_vals_opt_name_len, opt::name.len);
+
+            // If we’re printing the type, we have the following formats:
+            //
+            //     name <type>    Description
+            //     <name> : type  Description
+            //
+            // Apart from the type name, we also need to account for the extra
+            // ' <>' of normal options, and for the extra '<>' as well as the
+            // ' : ' of positional options.
+            if constexpr (should_print_argument_type<opt>) {
+                auto n = type_name<typename opt::canonical_type>();
+                max_len = std::max(
+                    max_len,
+                    opt::name.len + n.len + (is_positional_v<opt> ? 5 : 3)
+                );
+            }
+
+            // Otherwise, we only care about the name of the option and the
+            // extra '<>' of positional options.
+            else {
+                if constexpr (is_positional_v<opt>) max_len = std::max(max_len, opt::name.len + 2);
+                else max_len = std::max(max_len, opt::name.len);
+            }
+        });
+
+        // Append an argument.
+        auto append = [&]<typename opt> {
+            msg.append("    ");
+            auto old_len = msg.size();
+
+            // Append name.
+            if constexpr (is_positional_v<opt>) msg.append("<");
+            msg.append(opt::name.arr, opt::name.len);
+            if constexpr (is_positional_v<opt>) msg.append(">");
+
+            // Append type.
+            if constexpr (should_print_argument_type<opt>) {
+                auto tname = type_name<typename opt::canonical_type>();
+                msg.append(" : ");
+                msg.append(tname.arr, tname.len);
+            }
+
+            // Align to right margin.
+            auto len = msg.size() - old_len;
+            for (size_t i = 0; i < max_len - len; i++) msg.append(" ");
+
+            // Two extra spaces between this and the description.
+            msg.append("  ");
+            msg.append(opt::description.arr, opt::description.len);
+            msg.append("\n");
+        };
+
+        // Append the descriptions of positional options.
+        if (have_positional_opts) {
+            msg.append("\nArguments:\n");
+            positional::each(append);
+            msg.append("\n");
+        }
+
+        // Append non-positional options.
+        msg.append("Options:\n");
+        non_positional::each(append);
+
+        // If we have any values<> types, print their supported values.
+        if constexpr ((opts::is_values or ...)) {
+            msg.append("\nSupported option values:\n");
+            values_opts::each([&] <typename opt> {
+                if constexpr (opt::is_values) {
+                    msg.append("    ");
+                    msg.append(opt::name.arr, opt::name.len);
+                    msg.append(":");
+
+                    // Padding after the name.
+                    for (size_t i = 0; i < max_vals_opt_name_len - opt::name.len + 1; i++)
+                        msg.append(" ");
+
+                    // Option values.
+                    msg.len += opt::print_values(msg.arr + msg.len);
+                    msg.append("\n");
+                }
+            });
+        }
+
+        // Return the combined help message.
+        return msg;
+    } // clang-format on
+
+    /// Help message is created at compile time.
+    static constexpr help_string_t help_message_raw = make_help_message();
+
+public:
+    /// Get the help message.
+    static auto help() -> std::string {
+        return {help_message_raw.arr, help_message_raw.len};
+    }
+
+private:
+    // =======================================================================
+    //  References.
+    // =======================================================================
+    /// Add a referenced option to a tuple.
+    template <std::size_t index, static_string name, bool snapshot>
+    void add_referenced_option(auto& tuple) {
+        // +1 here because the first index is the actual option value.
+        auto& storage = std::get<index + 1>(tuple);
+        if (found<name>()) {
+            using opt = opt_by_name<name>;
+            if constexpr (opt::is_flag) storage = true;
+            else if constexpr (is_vector_v<storage_type_t<opt>>) {
+                if constexpr (snapshot) storage = ref_to_storage<name>().size();
+                else storage = ref_to_storage<name>();
+            }
+            else if constexpr (snapshot and not opt::is_overridable) storage = true;
+            else storage.emplace(copy_value(*optvals.template get<name>()));
+        }
+    }
+
+    /// Add all referenced options to a tuple.
+    template <bool snapshot, typename type, static_string... args>
+    auto add_referenced_options(auto& tuple, ref<type, args...>) {
+        [&]<std::size_t... i>(std::index_sequence<i...>) {
+            (add_referenced_option<i, nth_str<i, args...>(), snapshot>(tuple), ...);
+        }(std::make_index_sequence<sizeof...(args)>());
+    }
+
+    /// Collect all references referenced by an optio.
+    template <typename opt>
+    auto collect_references(auto value) {
+        using tuple_ty = single_element_storage_type_t<opt>;
+        auto tuple = std::make_obj_using_allocator<tuple_ty>(allocator);
+        std::get<0>(tuple) = std::move(value);
+        add_referenced_options<opt::is_snapshot_ref>(tuple, typename opt::declared_type_base{});
+        return tuple;
+    }
+
+    // =======================================================================
+    //  Parsing and Dispatch.
+    // =======================================================================
+    /// If this option takes a list of values, check that the value matches one of them.
+    template <typename opt>
+    void validate_value(std::string_view opt_str, std::string_view opt_val, const auto& value) {
+        if constexpr (opt::is_values) {
+            if (not opt::is_valid_option_value(value)) {
+                handle_error({
+                    .kind = error_kind::invalid_value,
+                    .option = opt_str,
+                    .argument = opt_val,
+                    .option_index = optindex<opt::name>(),
+                });
+            }
+        }
+    }
+
+    /// Handle an option value.
+    template <typename opt, bool is_multiple>
+    void dispatch_option_with_arg(std::string_view opt_str, std::string_view opt_val) {
+        using canonical = typename opt::canonical_type;
+
+        // Mark the option as found.
+        set_found<opt::name>();
+
+        // If this is a function option, simply call the callback and we're done.
+        if constexpr (detail::is_callback<canonical>) {
+            if constexpr (detail::is<canonical, callback_noarg_type>) opt::callback(user_data, opt_str);
+            else opt::callback(user_data, opt_str, opt_val);
+        }
+
+        // If only the last occurrence of this option is converted, just remember
+        // where it is; it is converted by convert_deferred_values().
+        else if constexpr (defer_conversion<opt>) {
+            deferred_values[optindex<opt::name>()] = {opt_str, opt_val, argi};
+        }
+
+        // Otherwise, convert and store the value.
+        else {
+            convert_option_value<opt, is_multiple>(opt_str, opt_val);
+        }
+    }
+
+    /// Take a value of a multiple<> option that we kept from the last parse, or create a new one.
+    template <typename opt>
+    auto take_spare_value() -> value_type_t<opt> {
+        using value_type = value_type_t<opt>;
+        auto& spare = std::get<optindex<opt::name>()>(spare_values);
+        if (not spare.empty()) {
+            auto value = std::move(spare.back());
+            spare.pop_back();
+            return value;
+        }
+
+        if constexpr (requires { value_type::is_file_data; })
+            return value_type{{}, std::make_obj_using_allocator<typename value_type::contents_type>(allocator)};
+        else return std::make_obj_using_allocator<value_type>(allocator);
+    }
+
+    /// Convert an option value into an existing value; see converts_in_place.
+    template <typename opt>
+    void convert_in_place(value_type_t<opt>& value, std::string_view opt_val) {
+        if constexpr (detail::is<typename opt::single_element_type, std::string>) value.assign(opt_val);
+        else if constexpr (load_in_parallel<opt>) defer_file_load<opt>(value, terminate_path(opt_val));
+        else load_file_into<opt>(value, terminate_path(opt_val), file_error_handler<opt>());
+    }
+
+    /// Convert an option value and store it.
+    template <typename opt, bool is_multiple>
+    void convert_option_value(std::string_view opt_str, std::string_view opt_val) {
+        // Strings and files can be converted in place; this reuses the memory of the
+        // previous value if we’re parsing into the same option values again.
+        if constexpr (converts_in_place<opt>) {
+            auto& storage = ref_to_storage<opt::name>();
+            auto& value = [&]() -> value_type_t<opt>& {
+                if constexpr (not is_multiple) return storage;
+                else {
+                    storage.push_back(take_spare_value<opt>());
+
+                    // Make sure reset() can move all of these into the spare values
+                    // without allocating.
+                    auto& spare = std::get<optindex<opt::name>()>(spare_values);
+                    if (spare.capacity() < storage.size()) spare.reserve(storage.capacity());
+                    return storage.back();
+                }
+            }();
+
+            convert_in_place<opt>(value, opt_val);
+            validate_value<opt>(opt_str, opt_val, value);
+        }
+
+        // Otherwise, parse the argument.
+        else {
+            // Create the argument value.
+            auto value = make_arg<opt>(opt_val);
+            validate_value<opt>(opt_str, opt_val, value);
+
+            // If this is a ref<> option, remember to unwrap it first.
+            auto& storage = ref_to_storage<opt::name>();
+            if constexpr (opt::is_ref) {
+                store_option_value<is_multiple>(
+                    storage,
+                    collect_references<opt>(std::move(value))
+                );
+            } else {
+                store_option_value<is_multiple>(storage, std::move(value));
+            }
+        }
+    }
+
+    /// Handle an option that may take an argument.
+    ///
+    /// Both --option value and --option=value are valid ways of supplying a
+    /// value. We test for both of them.
+    template <typename opt, bool is_multiple>
+    bool handle_opt_with_arg(std::string_view opt_str) {
+        using canonical = typename opt::canonical_type;
+
+        // --option=value or short opt.
+        if (opt_str.size() > opt::name.len) {
+            // Parse the rest of the option as the value if we have a '=' or if this is a short option.
+            if (opt_str[opt::name.len] == '=' or requires { opt::is_short; }) {
+                // Otherwise, parse the value.
+                auto opt_start_offs = opt::name.len + (opt_str[opt::name.len] == '=');
+                const auto opt_name = opt_str.substr(0, opt_start_offs);
+                const auto opt_val = opt_str.substr(opt_start_offs);
+                dispatch_option_with_arg<opt, is_multiple>(opt_name, opt_val);
+                return true;
+            }
+
+            // Otherwise, this isn’t the right option.
+            return false;
+        }
+
+        // Handle the option. If we get here, we know that the option name that we’ve
+        // encountered matches the option name exactly. If this is a func option that
+        // doesn’t take arguments, just call the callback and we’re done.
+        if constexpr (detail::is<canonical, callback_noarg_type>) {
+            opt::callback(user_data, opt_str);
+            return true;
+        }
+
+        // Otherwise, try to consume the next argument as the option value.
+        else {
+            // No more command line arguments left.
+            std::string_view opt_val;
+            if (not next_argument(opt_val)) {
+                // Don’t complain if we failed to read a response file.
+                if constexpr (has_response_files) {
+                    if (has_error) return true;
+                }
+
+                handle_error({
+                    .kind = error_kind::missing_argument,
+                    .option = opt_str,
+                    .option_index = optindex<opt::name>(),
+                    .argument_index = argi - 1,
+                });
+
+                // The option was still recognised, so don’t report it as unrecognised.
+                return true;
+            }
+
+            // Parse the argument.
+            dispatch_option_with_arg<opt, is_multiple>(opt_str, opt_val);
+            return true;
+        }
+    }
+
+    /// Handle an option. The parser calls this on each non-positional option.
+    template <typename opt>
+    bool handle_regular_impl(std::string_view opt_str) {
+        // If the supplied string doesn’t start with the option name, move on to the next option
+        if (not opt_str.starts_with(opt::name.sv())) return false;
+
+        // Check if this option accepts multiple values.
+        using element = typename opt::single_element_type;
+        static constexpr bool is_multiple = requires { opt::is_multiple; };
+        if constexpr (not is_multiple and not detail::is_callback<element>) {
+            // Duplicate options are not allowed, unless they’re overridable.
+            if (not opt::is_overridable and found<opt::name>()) {
+                handle_error({
+                    .kind = error_kind::duplicate_option,
+                    .option = opt::name.sv(),
+                    .argument = opt_str,
+                    .option_index = optindex<opt::name>(),
+                });
+                return true;
+            }
+        }
+
+        // Flags and callbacks that don't have arguments.
+        if constexpr (not detail::has_argument<element>) {
+            // Check if the name of this flag matches the entire option string that
+            // we encountered. If we’re just a prefix, then we don’t handle this.
+            if (opt_str != opt::name.sv()) return false;
+
+            // Mark the option as found. That’s all we need to do for flags.
+            set_found<opt::name>();
+
+            // If it’s a callable, call it.
+            if constexpr (detail::is_callback<element>) {
+                // The builtin help option is handled here. We pass the help message as an argument.
+                if constexpr (requires { opt::is_help_option; }) invoke_help_callback<opt>();
+
+                // If it’s not the help option, just invoke it.
+                else { opt::callback(user_data, opt_str); }
+            }
+
+            // Option has been handled.
+            return true;
+        }
+
+        // Handle an option that may take an argument.
+        else { return handle_opt_with_arg<opt, is_multiple>(opt_str); }
+    }
+
+    /// Handle a positional option.
+    template <typename opt>
+    bool handle_positional_impl(std::string_view opt_str) {
+        static_assert(not detail::is_callback<typename opt::canonical_type>, "positional<>s may not have a callback");
+
+        // Attempt to parse this as the option value. If this option only takes one
+        // value, any further positional arguments go to the next option.
+        static constexpr bool is_multiple = requires { opt::is_multiple; };
+        if constexpr (not is_multiple) positional_cursor++;
+        dispatch_option_with_arg<opt, is_multiple>(opt::name.sv(), opt_str);
+        return true;
+    }
+
+    /// Entry in the dispatch table for regular options.
+    template <typename opt>
+    bool handle_regular_dispatch(std::string_view opt_str) {
+        if constexpr (detail::is_positional_v<opt>) return false;
+        else return handle_regular_impl<opt>(opt_str);
+    }
+
+    /// Names of all non-positional options.
+    static constexpr option_name_table<sizeof...(opts)> regular_option_names{
+        std::array<std::string_view, sizeof...(opts)>{opts::name.sv()...},
+        std::array<bool, sizeof...(opts)>{not detail::is_positional_v<opts>...},
+    };
+
+    /// Which options are short options.
+    static constexpr std::array<bool, sizeof...(opts)> short_options{is_short_option<opts>::value...};
+
+    /// Names and indices of all non-positional options, sorted by name.
+    static constexpr auto sorted_regular_option_names = [] {
+        constexpr std::size_t count = (std::size_t(not detail::is_positional_v<opts>) + ...);
+        std::array<std::pair<std::string_view, std::size_t>, count> names{};
+        std::size_t i = 0, n = 0;
+        Foreach<opts...>([&]<typename opt> {
+            if constexpr (not detail::is_positional_v<opt>) names[n++] = {opt::name.sv(), i};
+            i++;
+        });
+        std::sort(names.begin(), names.end());
+        return names;
+    }();
+
+    /// Trie over the names of all non-positional options.
+    static constexpr option_name_trie<
+        sorted_regular_option_names.size(),
+        count_trie_nodes(sorted_regular_option_names)
+    > regular_option_prefixes{sorted_regular_option_names};
+
+    /// Handlers for all options, by option index.
+    static constexpr std::array<bool (clopts_impl::*)(std::string_view), sizeof...(opts)> regular_option_handlers{
+        &clopts_impl::handle_regular_dispatch<opts>...
+    };
+
+    /// Find the option that handles an argument and invoke handle_regular_impl on it.
+    bool handle_regular(std::string_view opt_str) {
+        // The option name matches the argument exactly.
+        if (auto i = regular_option_names.find(opt_str); i != sizeof...(opts))
+            return (this->*regular_option_handlers[i])(opt_str);
+
+        // Otherwise, this may be --option=value, or a short option followed by its
+        // value; find the longest option name that is followed by either.
+        auto i = regular_option_prefixes.longest_prefix(opt_str, [&](std::size_t index, std::size_t len) {
+            return len == opt_str.size() or opt_str[len] == '=' or short_options[index];
+        });
+
+        if (i == std::size_t(-1)) return false;
+        return (this->*regular_option_handlers[i])(opt_str);
+    }
+
+    /// Handlers for all positional options, in the order in which they are declared.
+    static constexpr auto positional_option_handlers = []<typename... positional_opts>(list<positional_opts...>) {
+        return std::array<bool (clopts_impl::*)(std::string_view), sizeof...(positional_opts)>{
+            &clopts_impl::handle_positional_impl<positional_opts>...
+        };
+    }(filter<is_positional, opts...>{});
+
+    /// Pass an argument to the first positional option that does not have a value yet.
+    bool handle_positional(std::string_view opt_str) {
+        if (positional_cursor == positional_option_handlers.size()) return false;
+        return (this->*positional_option_handlers[positional_cursor])(opt_str);
+    }
+
+    /// Characters that the name of a non-positional option can start with.
+    static constexpr auto option_start_chars = [] {
+        std::array<bool, 256> chars{};
+        Foreach<opts...>([&]<typename opt> {
+            if constexpr (not detail::is_positional_v<opt>) chars[static_cast<unsigned char>(opt::name.arr[0])] = true;
+        });
+        return chars;
+    }();
+
+    /// Check whether an argument could be the name of an option at all.
+    static bool may_be_option(std::string_view opt_str) {
+        return not opt_str.empty() and option_start_chars[static_cast<unsigned char>(opt_str.front())];
+    }
+
+    /// Get a callback that reports an error loading the file of an option.
+    template <typename opt>
+    auto file_error_handler() {
+        return [this](parse_error error) {
+            error.option = opt::name.sv();
+            error.option_index = optindex<opt::name>();
+            handle_error(error);
+        };
+    }
+
+    /// Option types whose value is a path that we pass to the OS.
+    template <typename type>
+    static constexpr bool takes_path = requires { type::is_file_data; } or
+                                       requires { type::is_mapped_file; } or
+                                       requires { type::is_lazy_file; } or
+                                       requires { type::is_watched_file; } or
+                                       requires { type::is_stream; } or
+                                       requires { type::is_output_file; } or
+                                       requires { type::is_lines; };
+
+    /// \brief Make sure a path is NUL-terminated.
+    ///
+    /// Arguments from argv and response files already are; arguments from
+    /// a range are copied. The copy lives until the end of the parse.
+    auto terminate_path(std::string_view path) -> std::string_view {
+        if (args_terminated) return path;
+        return {path_copies.add(path), path.size()};
     }
 
-    /// Helper to parse an integer or double.
-    template <typename number_type, static_string name>
-    auto parse_number(std::string_view s, auto parse_func) -> number_type {
-        number_type i{};
+    /// Parse an option value.
+    template <typename opt>
+    auto make_arg(std::string_view opt_val) -> value_type_t<opt> {
+        using element = typename opt::single_element_type;
+        if constexpr (takes_path<element>) opt_val = terminate_path(opt_val);
+
+        // Make sure this option takes an argument.
+        if constexpr (not detail::has_argument<element>) CLOPTS_ERR("This option type does not take an argument");
 
-        // The empty string is a valid integer *and* float, apparently.
-        if (s.empty()) {
-            handle_error("Expected ", name.sv(), ", got empty string");
-            return i;
-        }
+        // Strings do not require parsing.
+        else if constexpr (std::is_same_v<element, std::string>) return std::make_obj_using_allocator<value_type_t<opt>>(allocator, opt_val);
 
-        // Parse the number.
-        errno = 0;
-        char* pos{};
-        if constexpr (requires { parse_func(s.data(), &pos, 10); }) i = number_type(parse_func(s.data(), &pos, 10));
-        else i = number_type(parse_func(s.data(), &pos));
-        if (errno != 0 or *pos) handle_error(s, " does not appear to be a valid ", name.sv());
-        return i;
-    }
+        // String views just point into argv.
+        else if constexpr (std::is_same_v<element, std::string_view>) return opt_val;
 
-    /// Get the program name, if available.
-    auto program_name() const -> std::string_view {
-        if (argv) return argv[0];
-        return {};
-    }
+        // If it’s a file, read its contents.
+        else if constexpr (requires { element::is_file_data; }) {
+            if constexpr (has_dedupe_files) return load_file_deduplicated<opt>(opt_val);
+            else return load_file<opt>(opt_val, file_error_handler<opt>());
+        }
 
-    // =======================================================================
-    //  Internal Option Access.
-    // =======================================================================
-    /// Check if an option was found.
-    template <static_string option>
-    bool found() { return optvals.opts_found[optindex<option>()]; }
+        // Mapped files are mapped, not read; so are lines<>, which are indexed after mapping them.
+        else if constexpr (requires { element::is_mapped_file; } or requires { element::is_lines; }) {
+            if constexpr (has_dedupe_files) return map_file_deduplicated<opt>(opt_val);
+            else return detail::map_file_readonly<element>(opt_val, file_error_handler<opt>());
+        }
 
-    /// Get a reference to an option value.
-    template <static_string s>
-    [[nodiscard]] constexpr auto ref_to_storage() -> decltype(std::get<optindex<s>()>(optvals.optvals))& {
-        using value_type = decltype(std::get<optindex<s>()>(optvals.optvals));
+        // Lazy files are only checked for now.
+        else if constexpr (requires { element::is_lazy_file; }) return detail::open_lazy_file<element>(opt_val, file_error_handler<opt>());
 
-        // Bool options don’t have a value.
-        if constexpr (std::is_same_v<value_type, bool>) CLOPTS_ERR("Cannot call ref() on an option<bool>");
+        // Watched files are loaded now and reloaded whenever they change.
+        else if constexpr (requires { element::is_watched_file; }) return detail::open_watched_file<element>(opt_val, file_error_handler<opt>());
 
-        // Function options don’t have a value.
-        else if constexpr (detail::is_callback<value_type>) CLOPTS_ERR("Cannot call ref<>() on an option with function type.");
+        // Streams are only opened; the program reads them.
+        else if constexpr (requires { element::is_stream; }) return detail::open_stream<element>(opt_val, file_error_handler<opt>());
 
-        // Get the option value.
-        else return std::get<optindex<s>()>(optvals.optvals);
-    }
+        // Output files are created now so we can report errors early.
+        else if constexpr (requires { element::is_output_file; }) return detail::open_output_file<element>(opt_val, file_error_handler<opt>());
 
-    /// Mark an option as found.
-    template <static_string option>
-    void set_found() { optvals.opts_found[optindex<option>()] = true; }
+        // Parse an integer or double.
+        else if constexpr (std::is_same_v<element, integer>) return parse_number<opt, integer, "integer">(opt_val);
+        else if constexpr (std::is_same_v<element, double>) return parse_number<opt, double, "floating-point number">(opt_val);
 
-    /// Store an option value.
-    template <bool is_multiple>
-    void store_option_value(auto& ref, auto value) {
-        // Set the value.
-        if constexpr (is_multiple) ref.push_back(std::move(value));
-        else ref = std::move(value);
+        // Should never get here.
+        else CLOPTS_ERR("Unreachable");
     }
 
-    // =======================================================================
-    //  Help Message.
-    // =======================================================================
-    /// Create the help message.
-    static constexpr auto make_help_message() -> help_string_t { // clang-format off
-        using positional_unsorted = filter<is_positional, opts...>;
-        using positional = sort<get_option_name, positional_unsorted>;
-        using non_positional = sort<get_option_name, filter<is_not_positional, opts...>>;
-        using values_opts = sort<get_option_name, filter<is_values_option, opts...>>;
-        help_string_t msg{};
+    /// Check if we should stop parsing.
+    template <typename opt>
+    bool stop_parsing(std::string_view opt_str) {
+        if constexpr (requires { opt::is_stop_parsing; }) return opt_str == opt::name.sv();
+        return false;
+    }
 
-        // Append the positional options.
-        //
-        // Do NOT sort them here as this is where we print in what order
-        // they’re supposed to appear in, so sorting would be very stupid
-        // here.
-        bool have_positional_opts = false;
-        positional_unsorted::each([&]<typename opt> {
-            have_positional_opts = true;
-            if (not opt::is_required) msg.append("[");
-            msg.append("<");
-            msg.append(opt::name.arr, opt::name.len);
-            msg.append(">");
-            if (not opt::is_required) msg.append("]");
-            msg.append(" ");
-        });
+    /// \brief Count a file against the file budget.
+    ///
+    /// \return Whether the file still fits into the budget.
+    bool charge_file_budget(std::string_view path, std::size_t size, auto on_error) {
+        if (size <= file_budget_bytes - file_budget_used) {
+            file_budget_used += size;
+            return true;
+        }
 
-        // End of first line.
-        msg.append("[options]\n");
+        on_error(parse_error{.kind = error_kind::file_budget_exceeded, .argument = path});
+        return false;
+    }
 
-        // Determine the length of the longest name + typename so that
-        // we know how much padding to insert before actually printing
-        // the description. Also factor in the <> signs around and the
-        // space after the option name, as well as the type name.
-        size_t max_vals_opt_name_len{};
-        size_t max_len{};
-        Foreach<opts...>([&]<typename opt> {
-            if constexpr (opt::is_values)
-                max_vals_opt_name_len = std::max(max_vals_opt_name_len, opt::name.len);
+    /// \brief How many bytes a file will take up once it is loaded.
+    ///
+    /// \return The size of the file, or a negative value if we can only
+    /// tell once it has been read; see stat_file_size().
+    template <typename opt>
+    static auto file_load_size(std::string_view path) -> std::int64_t {
+        auto size = detail::stat_file_size(path);
+        if constexpr (requires { value_type_t<opt>::read_strategy::max_bytes; }) {
+            constexpr auto max = value_type_t<opt>::read_strategy::max_bytes;
+            if (size > 0 and std::uint64_t(size) > max) size = std::int64_t(std::min<std::uint64_t>(max, std::numeric_limits<std::int64_t>::max()));
+        }
+        return size;
+    }
 
-            // If we’re printing the type, we have the following formats:
-            //
-            //     name <type>    Description
-            //     <name> : type  Description
-            //
-            // Apart from the type name, we also need to account for the extra
-            // ' <>' of normal options, and for the extra '<>' as well as the
-            // ' : ' of positional options.
-            if constexpr (should_print_argument_type<opt>) {
-                auto n = type_name<typename opt::canonical_type>();
-                max_len = std::max(
-                    max_len,
-                    opt::name.len + n.len + (is_positional_v<opt> ? 5 : 3)
-                );
+    /// \brief Clear the contents of a file<> so we can load into them.
+    ///
+    /// Their memory is kept if they use our allocator; values that are part of
+    /// the option storage from the start don’t, since file<> isn’t allocator-aware.
+    template <typename contents_type>
+    void prepare_contents(contents_type& contents) {
+        if constexpr (requires { contents.get_allocator() != allocator; }) {
+            if (contents.get_allocator() != allocator) {
+                std::destroy_at(std::addressof(contents));
+                std::construct_at(std::addressof(contents), std::make_obj_using_allocator<contents_type>(allocator));
+                return;
             }
+        }
 
-            // Otherwise, we only care about the name of the option and the
-            // extra '<>' of positional options.
-            else {
-                if constexpr (is_positional_v<opt>) max_len = std::max(max_len, opt::name.len + 2);
-                else max_len = std::max(max_len, opt::name.len);
+        clear_value(contents);
+    }
+
+    /// Load a file<> into an existing value, respecting the file budget if there is one.
+    template <typename opt>
+    void load_file_into(value_type_t<opt>& file, std::string_view path, auto on_error) {
+        prepare_contents(file.contents);
+        if constexpr (not has_file_budget) detail::map_file_into(file, path, on_error);
+        else {
+            // Files whose size we don’t know in advance can only be counted once they’ve been read.
+            auto size = file_load_size<opt>(path);
+            if (size >= 0 and not charge_file_budget(path, std::size_t(size), on_error)) {
+                detail::assign_path(file.path, path);
+                return;
             }
-        });
 
-        // Append an argument.
-        auto append = [&]<typename opt> {
-            msg.append("    ");
-            auto old_len = msg.size();
+            bool failed = false;
+            detail::map_file_into(file, path, [&](parse_error e) { failed = true; on_error(e); });
+            if (size < 0 and not failed) charge_file_budget(path, file.contents.size() * sizeof(file.contents[0]), on_error);
+        }
+    }
 
-            // Append name.
-            if constexpr (is_positional_v<opt>) msg.append("<");
-            msg.append(opt::name.arr, opt::name.len);
-            if constexpr (is_positional_v<opt>) msg.append(">");
+    /// Load a file<>, respecting the file budget if there is one.
+    template <typename opt>
+    auto load_file(std::string_view path, auto on_error) -> value_type_t<opt> {
+        using file_type = value_type_t<opt>;
+        file_type file{{}, std::make_obj_using_allocator<typename file_type::contents_type>(allocator)};
+        load_file_into<opt>(file, path, on_error);
+        return file;
+    }
 
-            // Append type.
-            if constexpr (should_print_argument_type<opt>) {
-                auto tname = type_name<typename opt::canonical_type>();
-                msg.append(" : ");
-                msg.append(tname.arr, tname.len);
+#if CLOPTS_USE_MMAP
+    /// Load a file<> unless we’ve already loaded the same file the same way.
+    template <typename opt>
+    auto load_file_deduplicated(std::string_view path) -> value_type_t<opt> {
+        using file_type = value_type_t<opt>;
+        using contents_type = typename file_type::contents_type;
+        static constexpr const void* kind = &contents_kind<contents_type, typename file_type::read_strategy>;
+        auto id = detail::file_identity::of(path);
+        auto it = id ? file_cache.find(*id) : file_cache.end();
+        if (it != file_cache.end() and it->second.contents_kind == kind) {
+            auto& contents = *static_cast<const contents_type*>(it->second.contents.get());
+            if constexpr (has_file_budget) {
+                if (not charge_file_budget(path, contents.size() * sizeof(contents[0]), file_error_handler<opt>()))
+                    return file_type{typename file_type::path_type{path.begin(), path.end()}, {}};
             }
 
-            // Align to right margin.
-            auto len = msg.size() - old_len;
-            for (size_t i = 0; i < max_len - len; i++) msg.append(" ");
+            return file_type{typename file_type::path_type{path.begin(), path.end()}, copy_value(contents)};
+        }
 
-            // Two extra spaces between this and the description.
-            msg.append("  ");
-            msg.append(opt::description.arr, opt::description.len);
-            msg.append("\n");
-        };
+        bool failed = false;
+        auto value = load_file<opt>(path, [&](parse_error e) { failed = true; file_error_handler<opt>()(e); });
+        if (not id or failed) return value;
 
-        // Append the descriptions of positional options.
-        if (have_positional_opts) {
-            msg.append("\nArguments:\n");
-            positional::each(append);
-            msg.append("\n");
+        // If another option loaded this file differently, it keeps its buffer.
+        auto& cached = file_cache[*id];
+        if (not cached.contents) {
+            cached.contents = std::make_shared<const contents_type>(value.contents);
+            cached.contents_kind = kind;
         }
 
-        // Append non-positional options.
-        msg.append("Options:\n");
-        non_positional::each(append);
+        return value;
+    }
 
-        // If we have any values<> types, print their supported values.
-        if constexpr ((opts::is_values or ...)) {
-            msg.append("\nSupported option values:\n");
-            values_opts::each([&] <typename opt> {
-                if constexpr (opt::is_values) {
-                    msg.append("    ");
-                    msg.append(opt::name.arr, opt::name.len);
-                    msg.append(":");
+    /// Map a file unless we’ve already mapped the same file.
+    template <typename opt>
+    auto map_file_deduplicated(std::string_view path) -> typename opt::single_element_type {
+        using element = typename opt::single_element_type;
+        auto id = detail::file_identity::of(path);
+        if (id) {
+            if (auto it = file_cache.find(*id); it != file_cache.end() and it->second.mapping) return element{
+                typename element::path_type{path.begin(), path.end()},
+                *it->second.mapping,
+            };
+        }
 
-                    // Padding after the name.
-                    for (size_t i = 0; i < max_vals_opt_name_len - opt::name.len + 1; i++)
-                        msg.append(" ");
+        bool failed = false;
+        auto value = detail::map_file_readonly<element>(path, [&](parse_error e) { failed = true; file_error_handler<opt>()(e); });
+        if (id and not failed) file_cache[*id].mapping = value.mapping;
+        return value;
+    }
+#endif
 
-                    // Option values.
-                    msg.len += opt::print_values(msg.arr + msg.len);
-                    msg.append("\n");
-                }
-            });
+    /// \brief Remember to load a file once all arguments have been processed.
+    ///
+    /// For now, \p file, which must be the last value of the option, only gets
+    /// the path.
+    template <typename opt>
+    void defer_file_load(value_type_t<opt>& file, std::string_view path) {
+        static constexpr bool is_multiple = is_vector_v<storage_type_t<opt>>;
+        using file_type = value_type_t<opt>;
+        using contents_type = typename file_type::contents_type;
+
+        // Files can be loaded in a batch if their read strategy allows it and
+        // we know how to read them directly into their contents.
+        static constexpr bool batchable = requires { requires file_type::read_strategy::batchable; } and
+                                          sizeof(typename contents_type::value_type) == 1 and
+                                          requires (contents_type c) { c.resize(std::size_t{}); c.data(); };
+
+        // Files are counted against the budget before they are loaded; those whose
+        // size we can only know once they have been read are loaded right away.
+        std::int64_t size = 0;
+        if constexpr (has_file_budget) {
+            size = file_load_size<opt>(path);
+            if (size == -2) return load_file_into<opt>(file, path, file_error_handler<opt>());
         }
 
-        // Return the combined help message.
-        return msg;
-    } // clang-format on
-
-    /// Help message is created at compile time.
-    static constexpr help_string_t help_message_raw = make_help_message();
+        std::size_t element = 0;
+        if constexpr (is_multiple) element = ref_to_storage<opt::name>().size() - 1;
+        pending_files.push_back({
+            .load = &clopts_impl::load_pending_file<opt>,
+            .prepare = batchable ? &clopts_impl::prepare_pending_file<opt> : nullptr,
+            .option = opt::name.sv(),
+            .path = path,
+            .option_index = optindex<opt::name>(),
+            .element = element,
+            .size = size,
+            .argument_index = argi,
+            .error = 0,
+            .multiple = is_multiple,
+            .skip = false,
+            .loaded = false,
+            .over_budget = false,
+        });
 
-public:
-    /// Get the help message.
-    static auto help() -> std::string {
-        return {help_message_raw.arr, help_message_raw.len};
+        detail::assign_path(file.path, path);
+        prepare_contents(file.contents);
     }
 
-private:
-    // =======================================================================
-    //  References.
-    // =======================================================================
-    /// Add a referenced option to a tuple.
-    template <std::size_t index, static_string name>
-    void add_referenced_option(auto& tuple) {
-        // +1 here because the first index is the actual option value.
-        auto& storage = std::get<index + 1>(tuple);
-        if (found<name>()) {
-            using opt = opt_by_name<name>;
-            if constexpr (opt::is_flag) storage = true;
-            else if constexpr (is_vector_v<storage_type_t<opt>>) storage = ref_to_storage<name>();
-            else storage = std::make_optional(*optvals.template get<name>());
-        }
+    /// Get the file that a deferred load is for.
+    template <typename opt>
+    auto pending_file_data(const pending_file& p) -> value_type_t<opt>& {
+        auto& storage = ref_to_storage<opt::name>();
+        if constexpr (is_vector_v<storage_type_t<opt>>) return storage[p.element];
+        else return storage;
     }
 
-    /// Add all referenced options to a tuple.
-    template <typename type, static_string... args>
-    auto add_referenced_options(auto& tuple, ref<type, args...>) {
-        [&]<std::size_t... i>(std::index_sequence<i...>) {
-            (add_referenced_option<i, nth_str<i, args...>()>(tuple), ...);
-        }(std::make_index_sequence<sizeof...(args)>());
+    /// Load a file whose loading was deferred. This may be called on any thread.
+    template <typename opt>
+    void load_pending_file(pending_file& p) {
+        using strategy = typename value_type_t<opt>::read_strategy;
+        p.error = strategy::read(p.path, pending_file_data<opt>(p).contents);
     }
 
-    /// Collect all references referenced by an optio.
+    /// Resize the contents of a file whose loading was deferred and return a
+    /// pointer to them so we can read the file directly into them.
     template <typename opt>
-    auto collect_references(auto value) {
-        using tuple_ty = single_element_storage_type_t<opt>;
-        tuple_ty tuple;
-        std::get<0>(tuple) = std::move(value);
-        add_referenced_options(tuple, typename opt::declared_type_base{});
-        return tuple;
+    void* prepare_pending_file(pending_file& p, std::size_t size) {
+        auto& contents = pending_file_data<opt>(p).contents;
+        contents.resize(size);
+        return contents.data();
     }
 
-    // =======================================================================
-    //  Parsing and Dispatch.
-    // =======================================================================
-    /// Handle an option value.
-    template <typename opt, bool is_multiple>
-    void dispatch_option_with_arg(std::string_view opt_str, std::string_view opt_val) {
-        using canonical = typename opt::canonical_type;
-
-        // Mark the option as found.
-        set_found<opt::name>();
+#if CLOPTS_USE_IO_URING
+    /// \brief Load pending files in batches using io_uring.
+    ///
+    /// The files in a batch are opened and stat’ed, then read, then closed,
+    /// with a single system call for each step. Files that can’t be loaded
+    /// this way are left for the caller, as are all files if io_uring isn’t
+    /// available. If the ring fails partway through a batch, the files in
+    /// that batch and all later batches are left for the caller as well.
+    void load_pending_files_io_uring() {
+        // The first step needs two entries per file.
+        static constexpr std::size_t batch_size = 128;
+        static constexpr std::size_t max_read_size = 1 << 30;
+        detail::io_uring_queue ring{2 * batch_size};
+        if (not ring or not ring.supports({IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_CLOSE})) return;
+
+        struct entry {
+            pending_file* file;
+            int fd;
+            struct statx stat;
+        };
 
-        // If this is a function option, simply call the callback and we're done.
-        if constexpr (detail::is_callback<canonical>) {
-            if constexpr (detail::is<canonical, callback_noarg_type>) opt::callback(user_data, opt_str);
-            else opt::callback(user_data, opt_str, opt_val);
-        }
+        std::vector<entry> batch;
+        batch.reserve(batch_size);
+
+        // Wait for a number of completions. If the ring fails, wait for the entries
+        // that are still in flight so the kernel is done with the batch when we return;
+        // if we can’t even do that, the error is stored in ‘stuck’.
+        int stuck = 0;
+        auto wait = [&](std::size_t count, auto on_completion) {
+            while (count) {
+                if (ring.submit_and_wait()) {
+                    stuck = ring.drain(on_completion);
+                    return false;
+                }
 
-        // Otherwise, parse the argument.
-        else {
-            // Create the argument value.
-            auto value = make_arg<opt>(opt_val);
+                count -= ring.reap(on_completion);
+            }
+            return true;
+        };
 
-            // If this option takes a list of values, check that the
-            // value matches one of them.
-            if constexpr (opt::is_values) {
-                if (not opt::is_valid_option_value(value)) {
-                    handle_error(
-                        "Invalid value for option '",
-                        std::string(opt_str),
-                        "': '",
-                        std::string(opt_val),
-                        "'"
-                    );
+        // Give up on the current batch after the ring failed and close its files.
+        // If reads may still be in flight, we must not touch their contents, so
+        // report the error for those files instead of leaving them to the caller.
+        auto abandon_batch = [&] {
+            for (auto& e : batch) {
+                if (e.fd >= 0) ::close(e.fd);
+                if (not stuck) {
+                    e.file->loaded = false;
+                    e.file->error = 0;
+                } else if (not e.file->loaded) {
+                    e.file->loaded = true;
+                    e.file->error = stuck;
                 }
             }
+        };
 
-            // If this is a ref<> option, remember to unwrap it first.
-            auto& storage = ref_to_storage<opt::name>();
-            if constexpr (opt::is_ref) {
-                store_option_value<is_multiple>(
-                    storage,
-                    collect_references<opt>(std::move(value))
-                );
-            } else {
-                store_option_value<is_multiple>(storage, std::move(value));
+        for (std::size_t start = 0; start < pending_files.size();) {
+            batch.clear();
+            for (; start < pending_files.size() and batch.size() < batch_size; start++) {
+                auto& p = pending_files[start];
+                if (not p.skip and not p.loaded and p.prepare) batch.push_back({&p, -1, {}});
             }
-        }
-    }
 
-    /// Handle an option that may take an argument.
-    ///
-    /// Both --option value and --option=value are valid ways of supplying a
-    /// value. We test for both of them.
-    template <typename opt, bool is_multiple>
-    bool handle_opt_with_arg(std::string_view opt_str) {
-        using canonical = typename opt::canonical_type;
+            // Open and stat each file; the paths come from argv or response files, so they are NUL-terminated.
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                auto* e = &batch[i];
+                auto* open = ring.next();
+                open->opcode = IORING_OP_OPENAT;
+                open->fd = AT_FDCWD;
+                open->addr = std::uintptr_t(e->file->path.data());
+                open->open_flags = O_RDONLY | O_CLOEXEC;
+                open->user_data = 2 * i;
+
+                auto* stat = ring.next();
+                stat->opcode = IORING_OP_STATX;
+                stat->fd = AT_FDCWD;
+                stat->addr = std::uintptr_t(e->file->path.data());
+                stat->len = STATX_TYPE | STATX_SIZE;
+                stat->off = std::uintptr_t(&e->stat);
+                stat->user_data = 2 * i + 1;
+            }
 
-        // --option=value or short opt.
-        if (opt_str.size() > opt::name.len) {
-            // Parse the rest of the option as the value if we have a '=' or if this is a short option.
-            if (opt_str[opt::name.len] == '=' or requires { opt::is_short; }) {
-                // Otherwise, parse the value.
-                auto opt_start_offs = opt::name.len + (opt_str[opt::name.len] == '=');
-                const auto opt_name = opt_str.substr(0, opt_start_offs);
-                const auto opt_val = opt_str.substr(opt_start_offs);
-                dispatch_option_with_arg<opt, is_multiple>(opt_name, opt_val);
-                return true;
+            bool ok = wait(2 * batch.size(), [&](const io_uring_cqe& c) {
+                auto& e = batch[c.user_data / 2];
+                if (c.res < 0) e.file->error = -c.res;
+                else if (c.user_data % 2 == 0) e.fd = c.res;
+            });
+
+            if (not ok) return abandon_batch();
+
+            // Read each file that we could open into its contents. Files that are too
+            // large for a single read or whose size we don’t know are left to the slow path.
+            // A file only counts as loaded once we’ve read all of it.
+            std::size_t reads = 0;
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                auto* e = &batch[i];
+                if (e->file->error) {
+                    e->file->loaded = true;
+                    continue;
+                }
+
+                if (e->fd < 0 or not S_ISREG(e->stat.stx_mode) or e->stat.stx_size > max_read_size) continue;
+                auto* buffer = (this->*e->file->prepare)(*e->file, e->stat.stx_size);
+                if (e->stat.stx_size == 0) {
+                    e->file->loaded = true;
+                    continue;
+                }
+
+                auto* read = ring.next();
+                read->opcode = IORING_OP_READ;
+                read->fd = e->fd;
+                read->addr = std::uintptr_t(buffer);
+                read->len = std::uint32_t(e->stat.stx_size);
+                read->off = 0;
+                read->user_data = i;
+                reads++;
             }
 
-            // Otherwise, this isn’t the right option.
-            return false;
-        }
+            ok = wait(reads, [&](const io_uring_cqe& c) {
+                auto& e = batch[c.user_data];
+                e.file->loaded = true;
+                if (c.res < 0) {
+                    e.file->error = -c.res;
+                    return;
+                }
 
-        // Handle the option. If we get here, we know that the option name that we’ve
-        // encountered matches the option name exactly. If this is a func option that
-        // doesn’t take arguments, just call the callback and we’re done.
-        if constexpr (detail::is<canonical, callback_noarg_type>) {
-            opt::callback(user_data, opt_str);
-            return true;
-        }
+                // If the read was short, read the rest ourselves, and shrink the
+                // contents if the file turns out to be smaller than it was.
+                auto size = std::size_t(e.stat.stx_size);
+                auto n = std::size_t(c.res);
+                if (n == size) return;
+                auto* buffer = static_cast<char*>((this->*e.file->prepare)(*e.file, size));
+                auto rest = detail::read_at(e.fd, buffer + n, size - n, n);
+                if (rest < 0) e.file->error = errno;
+                else if (n + std::size_t(rest) < size) (this->*e.file->prepare)(*e.file, n + std::size_t(rest));
+            });
 
-        // Otherwise, try to consume the next argument as the option value.
-        else {
-            // No more command line arguments left.
-            if (++argi == argc) {
-                handle_error("Missing argument for option \"", opt_str, "\"");
-                return false;
+            if (not ok) return abandon_batch();
+
+            // Close the files. Any that we couldn’t close this way we close ourselves.
+            std::size_t closes = 0;
+            for (std::size_t i = 0; i < batch.size(); i++) {
+                if (batch[i].fd < 0) continue;
+                auto* close = ring.next();
+                close->opcode = IORING_OP_CLOSE;
+                close->fd = batch[i].fd;
+                close->user_data = i;
+                closes++;
             }
 
-            // Parse the argument.
-            dispatch_option_with_arg<opt, is_multiple>(opt_str, argv[argi]);
-            return true;
+            ok = wait(closes, [&](const io_uring_cqe& c) { batch[c.user_data].fd = -1; });
+            if (not ok) {
+                for (auto& e : batch)
+                    if (e.fd >= 0) ::close(e.fd);
+                return;
+            }
         }
     }
+#endif
 
-    /// Handle an option. The parser calls this on each non-positional option.
-    template <typename opt>
-    bool handle_regular_impl(std::string_view opt_str) {
-        // If the supplied string doesn’t start with the option name, move on to the next option
-        if (not opt_str.starts_with(opt::name.sv())) return false;
+    /// Load all files whose loading was deferred.
+    void load_pending_files() {
+        if constexpr (has_parallel_file_loading) {
+            if (pending_files.empty()) return;
+
+            // Only the last occurrence of an option that isn’t multiple<> needs to be
+            // loaded; the others were overridden, and they would share a value anyway.
+            std::bitset<sizeof...(opts)> seen;
+            for (auto& p : std::views::reverse(pending_files)) {
+                if (p.multiple) continue;
+                p.skip = seen[p.option_index];
+                seen.set(p.option_index);
+            }
 
-        // Check if this option accepts multiple values.
-        using element = typename opt::single_element_type;
-        static constexpr bool is_multiple = requires { opt::is_multiple; };
-        if constexpr (not is_multiple and not detail::is_callback<element>) {
-            // Duplicate options are not allowed, unless they’re overridable.
-            if (not opt::is_overridable and found<opt::name>()) {
-                std::string errmsg;
-                errmsg += "Duplicate option: \"";
-                errmsg += opt_str;
-                errmsg += "\"";
-                handle_error(std::move(errmsg));
-                return false;
+            // Don’t load any files that exceed the budget.
+            if constexpr (has_file_budget) {
+                for (auto& p : pending_files) {
+                    if (p.skip or p.size < 0) continue;
+                    p.over_budget = p.loaded = not charge_file_budget(p.path, std::size_t(p.size), [](parse_error) {});
+                }
             }
-        }
 
-        // Flags and callbacks that don't have arguments.
-        if constexpr (not detail::has_argument<element>) {
-            // Check if the name of this flag matches the entire option string that
-            // we encountered. If we’re just a prefix, then we don’t handle this.
-            if (opt_str != opt::name.sv()) return false;
+#if CLOPTS_USE_IO_URING
+            load_pending_files_io_uring();
+#endif
 
-            // Mark the option as found. That’s all we need to do for flags.
-            set_found<opt::name>();
+            // Load the remaining files; this thread helps out too.
+            std::atomic<std::size_t> next = 0;
+            auto work = [&] {
+                for (auto i = next++; i < pending_files.size(); i = next++) {
+                    auto& p = pending_files[i];
+                    if (not p.skip and not p.loaded) (this->*p.load)(p);
+                }
+            };
 
-            // If it’s a callable, call it.
-            if constexpr (detail::is_callback<element>) {
-                // The builtin help option is handled here. We pass the help message as an argument.
-                if constexpr (requires { opt::is_help_option; }) invoke_help_callback<opt>();
+            auto remaining = std::ranges::count_if(pending_files, [](const pending_file& p) { return not p.skip and not p.loaded; });
+            auto threads = file_loading_threads ? file_loading_threads : std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min<std::size_t>(threads, std::size_t(remaining));
+            if (remaining) {
+                std::vector<std::jthread> workers;
+                workers.reserve(threads - 1);
+                for (std::size_t i = 1; i < threads; i++) workers.emplace_back(work);
+                work();
+            }
 
-                // If it’s not the help option, just invoke it.
-                else { opt::callback(user_data, opt_str); }
+            // Report errors in the order in which the files were passed.
+            std::ranges::stable_sort(pending_files, {}, &pending_file::argument_index);
+            auto saved_argi = argi;
+            for (auto& p : pending_files) {
+                if (p.skip or not (p.error or p.over_budget)) continue;
+                argi = p.argument_index;
+                handle_error({
+                    .kind = p.over_budget ? error_kind::file_budget_exceeded : error_kind::file_error,
+                    .option = p.option,
+                    .argument = p.path,
+                    .option_index = p.option_index,
+                    .error_code = p.error,
+                });
+
+                if (has_error) break;
             }
 
-            // Option has been handled.
-            return true;
+            argi = saved_argi;
+            pending_files.clear();
         }
+    }
 
-        // Handle an option that may take an argument.
-        else { return handle_opt_with_arg<opt, is_multiple>(opt_str); }
+    /// Convert the values of options whose conversion was deferred.
+    void convert_deferred_values() {
+        if constexpr (has_defer_overrides) {
+            // Errors should point to the argument that the value came from.
+            auto saved_argi = argi;
+            Foreach<opts...>([&]<typename opt> {
+                if constexpr (defer_conversion<opt>) {
+                    if (has_error or not found<opt::name>()) return;
+                    auto& d = deferred_values[optindex<opt::name>()];
+                    argi = d.argument_index;
+                    convert_option_value<opt, false>(d.option, d.value);
+                }
+            });
+            argi = saved_argi;
+        }
     }
 
-    /// Handle a positional option.
-    template <typename opt>
-    bool handle_positional_impl(std::string_view opt_str) {
-        static_assert(not detail::is_callback<typename opt::canonical_type>, "positional<>s may not have a callback");
+    /// \brief Read a response file and push it onto the stack of response files.
+    void open_response_file(std::string_view path) {
+        path = terminate_path(path);
+        auto id = identify_response_file(path);
+        bool recursive = response_file_stack.size() == response_file_depth or
+                         (id and std::ranges::any_of(response_file_stack, [&](const response_file& f) { return f.id == id; }));
 
-        // If we've already encountered this positional option, then return.
-        static constexpr bool is_multiple = requires { opt::is_multiple; };
-        if constexpr (not is_multiple) {
-            if (found<opt::name>()) return false;
+        if (recursive) {
+            handle_error({.kind = error_kind::recursive_response_file, .argument = path});
+            return;
         }
 
-        // Otherwise, attempt to parse this as the option value.
-        dispatch_option_with_arg<opt, is_multiple>(opt::name.sv(), opt_str);
-        return true;
-    }
-
-    /// Invoke handle_regular_impl on every option until one returns true.
-    bool handle_regular(std::string_view opt_str) {
-        const auto handle = [this]<typename opt>(std::string_view str) {
-            // `this->` is to silence a warning.
-            if constexpr (detail::is_positional_v<opt>) return false;
-            else return this->handle_regular_impl<opt>(str);
-        };
+        int error = 0;
+        auto mapping = detail::file_mapping::open(path, error, true);
+        if (error) {
+            handle_error({.kind = error_kind::file_error, .argument = path, .error_code = error});
+            return;
+        }
 
-        return (handle.template operator()<opts>(opt_str) or ...);
+        response_file_stack.push_back({detail::argument_tokenizer{mapping.writable_view()}, std::move(id)});
+        optvals.response_files.push_back(std::move(mapping));
     }
 
-    /// Invoke handle_positional_impl on every option until one returns true.
-    bool handle_positional(std::string_view opt_str) {
-        const auto handle = [this]<typename opt>(std::string_view str) {
-            // `this->` is to silence a warning.
-            if constexpr (detail::is_positional_v<opt>) return this->handle_positional_impl<opt>(str);
-            else return false;
-        };
+    /// \brief Get the next argument.
+    ///
+    /// If response files are enabled, arguments of the form \c @file are
+    /// replaced with the arguments in that file; \c argi remains the index
+    /// of the \c @file argument while we’re reading from the file.
+    ///
+    /// \return false if there are no arguments left.
+    bool next_argument(std::string_view& arg) {
+        for (;;) {
+            if constexpr (has_response_files) {
+                if (not response_file_stack.empty()) {
+                    if (not response_file_stack.back().arguments.next(arg)) {
+                        response_file_stack.pop_back();
+                        continue;
+                    }
+                } else if (not next_top_level_argument(arg)) {
+                    return false;
+                }
 
-        return (handle.template operator()<opts>(opt_str) or ...);
+                if (arg.size() < 2 or arg.front() != '@') return true;
+                open_response_file(arg.substr(1));
+                if (has_error) return false;
+            } else {
+                return next_top_level_argument(arg);
+            }
+        }
     }
 
-    /// Parse an option value.
-    template <typename opt>
-    auto make_arg(std::string_view opt_val) -> typename opt::single_element_type {
-        using element = typename opt::single_element_type;
+    /// Get the next argument from argv or the range we’re parsing.
+    bool next_top_level_argument(std::string_view& arg) {
+        if (source) {
+            if (source.next(arg)) {
+                argi++;
+                return true;
+            }
 
-        // Make sure this option takes an argument.
-        if constexpr (not detail::has_argument<element>) CLOPTS_ERR("This option type does not take an argument");
+            // Now that we know how many arguments there are, pretend they were in argv.
+            source = {};
+            argc = argi + 1;
+        }
 
-        // Strings do not require parsing.
-        else if constexpr (std::is_same_v<element, std::string>) return std::string{opt_val};
+        if (argi + 1 >= argc) {
+            argi = argc;
+            return false;
+        }
 
-        // If it’s a file, read its contents.
-        else if constexpr (requires { element::is_file_data; }) return detail::map_file<element>(opt_val, error_handler);
+        arg = argv[++argi];
+        return true;
+    }
 
-        // Parse an integer or double.
-        else if constexpr (std::is_same_v<element, integer>) return parse_number<integer, "integer">(opt_val, std::strtoull);
-        else if constexpr (std::is_same_v<element, double>) return parse_number<double, "floating-point number">(opt_val, std::strtod);
+    /// Collect the arguments after the stop_parsing<> option.
+    void save_unprocessed_args() {
+        if constexpr (has_stop_parsing) {
+            bool in_response_file = false;
+            if constexpr (has_response_files) in_response_file = not response_file_stack.empty();
+            if (not in_response_file and not source) {
+                if (argv) optvals.unprocessed_args = std::span<const char*>{argv + argi, static_cast<std::size_t>(argc - argi)};
+                return;
+            }
 
-        // Should never get here.
-        else CLOPTS_ERR("Unreachable");
-    }
+            // If we stopped in a response file, the rest of it comes first; arguments
+            // from a range have to be copied since they aren’t NUL-terminated.
+            auto storage = std::make_shared<unprocessed_args_storage>();
+            if constexpr (has_response_files) {
+                for (auto& f : std::views::reverse(response_file_stack))
+                    for (std::string_view arg; f.arguments.next(arg);) storage->args.push_back(arg.data());
+                response_file_stack.clear();
+            }
 
-    /// Check if we should stop parsing.
-    template <typename opt>
-    bool stop_parsing(std::string_view opt_str) {
-        if constexpr (requires { opt::is_stop_parsing; }) return opt_str == opt::name.sv();
-        return false;
+            if (source) {
+                for (std::string_view arg; source.next(arg);)
+                    storage->args.push_back(args_terminated ? arg.data() : storage->copies.add(arg));
+            } else if (argv) {
+                storage->args.insert(storage->args.end(), argv + argi, argv + argc);
+            }
+
+            optvals.unprocessed_args = storage->args;
+            optvals.unprocessed_storage = std::move(storage);
+        }
     }
 
     void parse() {
         // Main parser loop.
-        for (argi = 1; argi < argc; argi++) {
-            std::string_view opt_str{argv[argi]};
-
+        argi = 0;
+        for (std::string_view opt_str; next_argument(opt_str);) {
             // Stop parsing if this is the stop_parsing<> option.
             if ((stop_parsing<special>(opt_str) or ...)) {
                 argi++;
                 break;
             }
 
-            // Attempt to handle the option.
-            if (not handle_regular(opt_str) and not handle_positional(opt_str)) {
-                std::string errmsg;
-                errmsg += "Unrecognized option: \"";
-                errmsg += opt_str;
-                errmsg += "\"";
-                handle_error(std::move(errmsg));
+            // Attempt to handle the option. Arguments that can’t be options
+            // only need to be checked against positional options.
+            bool handled = may_be_option(opt_str) and handle_regular(opt_str);
+            if (not handled and not handle_positional(opt_str)) {
+                handle_error({.kind = error_kind::unrecognised_option, .argument = opt_str});
             }
 
             // Stop parsing if there was an error.
             if (has_error) return;
         }
 
+        // We may have failed to read a response file.
+        if constexpr (has_response_files) {
+            if (has_error) return;
+        }
+
+        // Convert the last occurrence of any options we’ve skipped, and
+        // load any files we haven’t loaded yet.
+        convert_deferred_values();
+        load_pending_files();
+#if CLOPTS_USE_MMAP
+        if constexpr (has_dedupe_files) file_cache.clear();
+#endif
+        if (has_error) return;
+
         // Make sure all required options were found.
         Foreach<opts...>([&]<typename opt>() {
             if (not found<opt::name>() and opt::is_required) {
-                std::string errmsg;
-                errmsg += "Option \"";
-                errmsg += opt::name.sv();
-                errmsg += "\" is required";
-                handle_error(std::move(errmsg));
+                handle_error({
+                    .kind = error_kind::missing_required_option,
+                    .option = opt::name.sv(),
+                    .option_index = optindex<opt::name>(),
+                });
             }
         });
 
         // Save unprocessed options.
+        save_unprocessed_args();
+
+        // Only discard the contents of output files if parsing succeeded; otherwise,
+        // they are truncated when the program first writes to them.
+        if (error_reported) return;
+        Foreach<opts...>([&]<typename opt> {
+            if constexpr (requires { opt::single_element_type::is_output_file; })
+                if (found<opt::name>()) truncate_output_files(ref_to_storage<opt::name>());
+        });
+    }
+
+    /// Truncate the files of output_file<> options.
+    template <typename type>
+    static void truncate_output_files(type& value) {
+        if constexpr (requires { type::is_output_file; }) value.handle.truncate();
+        else if constexpr (is_vector_v<type>) for (auto& v : value) truncate_output_files(v);
+        else if constexpr (requires { std::tuple_size<type>::value; }) {
+            std::apply([](auto&... elements) { (truncate_output_files(elements), ...); }, value);
+        }
+    }
+
+    /// Clear an option value, but keep any memory it owns.
+    template <typename type>
+    static void clear_value(type& value) {
+        if constexpr (requires { value.clear(); }) value.clear();
+        else if constexpr (requires { value.reset(); }) value.reset();
+        else if constexpr (requires { type::is_file_data; }) {
+            clear_value(value.path);
+            clear_value(value.contents);
+        } else if constexpr (requires { std::tuple_size<type>::value; }) {
+            std::apply([](auto&... elements) { (clear_value(elements), ...); }, value);
+        } else {
+            value = type{};
+        }
+    }
+
+    /// Reset the parser state and clear all option values.
+    void reset() {
+        // Keep the values of multiple<> options that we can convert into. They are
+        // taken back from the end, so store them in reverse to reuse each for the
+        // same argument if we parse the same arguments again.
+        Foreach<opts...>([&]<typename opt> {
+            if constexpr (reuses_elements<opt>) {
+                auto& storage = ref_to_storage<opt::name>();
+                auto& spare = std::get<optindex<opt::name>()>(spare_values);
+                for (auto& value : std::views::reverse(storage)) spare.push_back(std::move(value));
+                storage.clear();
+            }
+        });
+
+        std::apply([](auto&... values) { (clear_value(values), ...); }, optvals.optvals);
+        optvals.opts_found.reset();
         if constexpr (has_stop_parsing) {
-            optvals.unprocessed_args = std::span<const char*>{
-                argv + argi,
-                static_cast<std::size_t>(argc - argi),
-            };
+            optvals.unprocessed_args = {};
+            optvals.unprocessed_storage = {};
+        }
+
+        has_error = false;
+        error_reported = false;
+        positional_cursor = 0;
+        if constexpr (has_parallel_file_loading) pending_files.clear();
+#if CLOPTS_USE_MMAP
+        if constexpr (has_dedupe_files) file_cache.clear();
+#endif
+        if constexpr (has_file_budget) file_budget_used = 0;
+        if constexpr (has_response_files) {
+            optvals.response_files.clear();
+            response_file_stack.clear();
+        }
+
+        path_copies.clear();
+    }
+
+    /// Set the error handler; the handler must outlive the parser.
+    template <typename callable>
+    void set_error_handler(callable& handler) {
+        if constexpr (std::is_null_pointer_v<callable>) error_handler = {};
+        else if (is_null_error_handler(handler)) error_handler = {};
+        else error_handler = error_handler_ref{handler};
+    }
+
+    /// Parse command line options using an allocator.
+    static auto parse_impl(
+        int argc,
+        const char* const* const argv,
+        auto& error_handler,
+        void* user_data,
+        const allocator_type& alloc
+    ) -> optvals_type {
+        // Initialise state.
+        clopts_impl self{alloc};
+        self.set_error_handler(error_handler);
+        self.argc = argc;
+        self.user_data = user_data;
+
+        // Safe because we don’t attempt to modify argv anyway. This
+        // is just so we can pass in both e.g. a `const char**` and a
+        // `char **`.
+        self.argv = const_cast<const char**>(argv);
+
+        // Parse the options.
+        self.parse();
+        return std::move(self.optvals);
+    }
+
+    /// Parse a range of arguments; the first one is the program name.
+    template <typename range>
+    void parse_range(range&& args) {
+        std::pair<std::ranges::iterator_t<range>, std::ranges::sentinel_t<range>> cursor{
+            std::ranges::begin(args),
+            std::ranges::end(args),
+        };
+
+        argv = nullptr;
+        argc = std::numeric_limits<int>::max();
+        args_terminated = false;
+        program = {};
+        if (cursor.first != cursor.second) {
+            program = std::string_view(*cursor.first);
+            ++cursor.first;
         }
+
+        source = detail::argument_source{cursor};
+        parse();
+        source = {};
+    }
+
+    /// Split a command line into arguments and parse them; the first one is the program name.
+    void parse_string(std::string_view command_line) {
+        auto text = optvals.command_line.assign(command_line);
+        auto parse_arguments = [&](auto arguments) {
+            argv = nullptr;
+            argc = std::numeric_limits<int>::max();
+            args_terminated = true;
+            if (not arguments.next(program)) program = {};
+            source = detail::argument_source{arguments};
+            parse();
+            source = {};
+        };
+
+        // A command line that contains NUL bytes can’t have come from a shell.
+        if (command_line.find('\0') != std::string_view::npos) parse_arguments(detail::nul_separated_arguments{text});
+        else parse_arguments(detail::argument_tokenizer{text});
+    }
+
+    /// Parse a command line using an allocator.
+    static auto parse_command_line_impl(
+        std::string_view command_line,
+        auto& error_handler,
+        void* user_data,
+        const allocator_type& alloc
+    ) -> optvals_type {
+        clopts_impl self{alloc};
+        self.set_error_handler(error_handler);
+        self.user_data = user_data;
+        self.parse_string(command_line);
+        return std::move(self.optvals);
+    }
+
+    /// Parse a range of arguments using an allocator.
+    template <typename range>
+    static auto parse_range_impl(
+        range&& args,
+        auto& error_handler,
+        void* user_data,
+        const allocator_type& alloc
+    ) -> optvals_type {
+        clopts_impl self{alloc};
+        self.set_error_handler(error_handler);
+        self.user_data = user_data;
+        self.parse_range(std::forward<range>(args));
+        return std::move(self.optvals);
     }
 
 public:
+    /// \brief Parser that can be used to parse several command lines.
+    ///
+    /// Every call to \c parse() parses into the same option values; the
+    /// strings, vectors, and file contents and paths that hold them keep their
+    /// memory between parses, as do the elements of \c multiple\<> options
+    /// and the copies of non-NUL-terminated paths, so parsing the same command
+    /// line again does not allocate once the parser has warmed up. The
+    /// exceptions are:
+    ///
+    ///   - values that are larger than any earlier value in the same place;
+    ///   - \c ref\<> options, whose values are always created anew;
+    ///   - files loaded with \c dedupe_files, since the cache is cleared
+    ///     between parses, and contents types such as \c shared_buffer
+    ///     that allocate a new buffer for every file;
+    ///   - the arguments saved by \c stop_parsing\<> when parsing a range;
+    ///   - error messages.
+    ///
+    /// The parser stores a copy of the error handler.
+    template <typename error_handler_type = std::nullptr_t>
+    class parser {
+        error_handler_type handler;
+        clopts_impl impl;
+
+        explicit parser(const allocator_type& alloc, error_handler_type error_handler, void* user_data)
+            : handler{std::move(error_handler)}, impl{alloc} {
+            impl.set_error_handler(handler);
+            impl.user_data = user_data;
+        }
+
+    public:
+        /// \brief Create a parser.
+        ///
+        /// \see clopts_impl::parse() for a description of the parameters.
+        explicit parser(error_handler_type error_handler = nullptr, void* user_data = nullptr)
+        requires (not uses_memory_resource)
+            : parser{{}, std::move(error_handler), user_data} {}
+
+        /// \brief Create a parser whose option values are allocated using a memory resource.
+        ///
+        /// The memory resource must outlive the parser.
+        explicit parser(std::pmr::memory_resource* resource, error_handler_type error_handler = nullptr, void* user_data = nullptr)
+        requires uses_memory_resource
+            : parser{allocator_type{resource}, std::move(error_handler), user_data} {}
+
+        parser(const parser&) = delete;
+        parser(parser&&) = delete;
+        parser& operator=(const parser&) = delete;
+        parser& operator=(parser&&) = delete;
+
+        /// \brief Parse command line options.
+        ///
+        /// This discards the option values from the previous call to \c parse(). The
+        /// returned reference is valid until the next call to \c parse() or \c reset()
+        /// or until the parser is destroyed.
+        auto parse(int argc, const char* const* const argv) -> optvals_type& {
+            impl.reset();
+            impl.argc = argc;
+            impl.argv = const_cast<const char**>(argv);
+            impl.args_terminated = true;
+            impl.parse();
+            return impl.optvals;
+        }
+
+        /// \brief Parse a range of arguments.
+        ///
+        /// \see clopts_impl::parse(range&&, error_handler_type&&, void*)
+        template <detail::argument_range range>
+        auto parse(range&& args) -> optvals_type& {
+            impl.reset();
+            impl.parse_range(std::forward<range>(args));
+            return impl.optvals;
+        }
+
+        /// \brief Split a command line into arguments and parse them.
+        ///
+        /// \see clopts_impl::parse_command_line(std::string_view, error_handler_type&&, void*)
+        auto parse_command_line(std::string_view command_line) -> optvals_type& {
+            impl.reset();
+            impl.parse_string(command_line);
+            return impl.optvals;
+        }
+
+        /// Clear all option values, but keep the memory they own.
+        void reset() { impl.reset(); }
+    };
+
     /// \brief Parse command line options.
     ///
     /// \param argc The argument count.
     /// \param argv The arguments (including the program name).
     /// \param user_data User data passed to any func\<\> options that accept a \c void*.
-    /// \param error_handler A callback that is invoked whenever an error occurs. If
-    ///        \c nullptr is passed, the default error handler is used. The error handler
-    ///        should return \c true if parsing should continue and \c false otherwise.
+    /// \param error_handler A callback that is invoked whenever an error occurs; it
+    ///        is passed either the error message as a \c std::string&& or the
+    ///        \c parse_error itself. If \c nullptr is passed, the default error handler
+    ///        is used. The error handler should return \c true if parsing should continue
+    ///        and \c false otherwise.
     /// \return The parsed option values.
+    template <typename error_handler_type = std::nullptr_t>
     static auto parse(
         int argc,
         const char* const* const argv,
-        std::function<bool(std::string&&)> error_handler = nullptr,
+        error_handler_type&& error_handler = nullptr,
         void* user_data = nullptr
-    ) -> optvals_type {
-        // Initialise state.
-        clopts_impl self;
-        if (error_handler) self.error_handler = error_handler;
-        else self.error_handler = [&](auto&& e) { return self.default_error_handler(std::forward<decltype(e)>(e)); };
-        self.argc = argc;
-        self.user_data = user_data;
+    ) -> optvals_type
+    requires (not uses_memory_resource) {
+        return parse_impl(argc, argv, error_handler, user_data, {});
+    }
 
-        // Safe because we don’t attempt to modify argv anyway. This
-        // is just so we can pass in both e.g. a `const char**` and a
-        // `char **`.
-        self.argv = const_cast<const char**>(argv);
+    /// \brief Parse command line options, allocating all option values using
+    /// a memory resource.
+    ///
+    /// The memory resource must outlive the returned option values.
+    ///
+    /// \see parse(int, const char* const*, error_handler_type&&, void*)
+    template <typename error_handler_type = std::nullptr_t>
+    static auto parse(
+        int argc,
+        const char* const* const argv,
+        std::pmr::memory_resource* resource,
+        error_handler_type&& error_handler = nullptr,
+        void* user_data = nullptr
+    ) -> optvals_type
+    requires uses_memory_resource {
+        return parse_impl(argc, argv, error_handler, user_data, allocator_type{resource});
+    }
+
+    /// \brief Parse a range of arguments instead of argv.
+    ///
+    /// The first element is the program name. The arguments need not be
+    /// NUL-terminated and are not copied, except for file paths, so they must
+    /// stay valid for as long as the parser may refer to them: \c std::string_view
+    /// option values point into them. Any input range whose elements convert
+    /// to \c std::string_view works, so the arguments can also be generated
+    /// as they are parsed.
+    ///
+    /// \see parse(int, const char* const*, error_handler_type&&, void*)
+    template <detail::argument_range range, typename error_handler_type = std::nullptr_t>
+    static auto parse(
+        range&& args,
+        error_handler_type&& error_handler = nullptr,
+        void* user_data = nullptr
+    ) -> optvals_type
+    requires (not uses_memory_resource) {
+        return parse_range_impl(std::forward<range>(args), error_handler, user_data, {});
+    }
+
+    /// \brief Parse a range of arguments, allocating all option values using
+    /// a memory resource.
+    ///
+    /// \see parse(range&&, error_handler_type&&, void*)
+    template <detail::argument_range range, typename error_handler_type = std::nullptr_t>
+    static auto parse(
+        range&& args,
+        std::pmr::memory_resource* resource,
+        error_handler_type&& error_handler = nullptr,
+        void* user_data = nullptr
+    ) -> optvals_type
+    requires uses_memory_resource {
+        return parse_range_impl(std::forward<range>(args), error_handler, user_data, allocator_type{resource});
+    }
+
+    /// \brief Split a command line into arguments, like a shell would, and parse them.
+    ///
+    /// The first argument is the program name. Arguments are separated by
+    /// whitespace; quotes and backslashes work as in a POSIX shell, but nothing
+    /// is expanded. If the command line contains NUL bytes, as e.g. the contents
+    /// of \c /proc/<pid>/cmdline do, it is split at those instead, and quotes
+    /// and backslashes are not special.
+    ///
+    /// The command line is copied once, and the arguments are split in that copy,
+    /// which is owned by the returned option values, so the command line need not
+    /// outlive them.
+    ///
+    /// \see parse(int, const char* const*, error_handler_type&&, void*)
+    template <typename error_handler_type = std::nullptr_t>
+    static auto parse_command_line(
+        std::string_view command_line,
+        error_handler_type&& error_handler = nullptr,
+        void* user_data = nullptr
+    ) -> optvals_type
+    requires (not uses_memory_resource) {
+        return parse_command_line_impl(command_line, error_handler, user_data, {});
+    }
 
-        // Parse the options.
-        self.parse();
-        return std::move(self.optvals);
+    /// \brief Split a command line into arguments and parse them, allocating all
+    /// option values using a memory resource.
+    ///
+    /// \see parse_command_line(std::string_view, error_handler_type&&, void*)
+    template <typename error_handler_type = std::nullptr_t>
+    static auto parse_command_line(
+        std::string_view command_line,
+        std::pmr::memory_resource* resource,
+        error_handler_type&& error_handler = nullptr,
+        void* user_data = nullptr
+    ) -> optvals_type
+    requires uses_memory_resource {
+        return parse_command_line_impl(command_line, error_handler, user_data, allocator_type{resource});
     }
 };
 
@@ -1622,11 +4792,26 @@ public:
 template <typename... opts>
 using clopts = detail::clopts_impl< // clang-format off
     detail::filter<detail::regular_option, opts...>,
-    detail::filter<detail::special_option, opts...>
+    detail::filter<detail::special_option, opts...>,
+    detail::default_storage
+>; // clang-format on
+
+namespace pmr {
+/// Command-line options type whose option values are allocated using a
+/// std::pmr::memory_resource that is passed to parse().
+template <typename... opts>
+using clopts = detail::clopts_impl< // clang-format off
+    detail::filter<detail::regular_option, opts...>,
+    detail::filter<detail::special_option, opts...>,
+    detail::pmr_storage
 >; // clang-format on
+} // namespace pmr
 
 /// Types.
+using detail::error_kind;
+using detail::parse_error;
 using detail::ref;
+using detail::snapshot_ref;
 using detail::values;
 
 /// Base option type.
@@ -1666,15 +4851,375 @@ struct short_option : detail::opt_impl<_name, _description, _type, required, ove
 };
 } // namespace experimental
 
+/// \brief Ways in which a file<> option can read a file.
+///
+/// A read strategy has a static \c read() function that takes the path of the
+/// file, which is NUL-terminated, and the contents of the file<>, which it
+/// should fill in. It returns 0 on success and the value of \c errno otherwise.
+///
+/// A strategy that only cares about the contents ending up in memory, not how
+/// they get there, can set \c batchable to \c true; if \c CLOPTS_USE_IO_URING
+/// is enabled, parallel_file_loading<> then loads such files in batches.
+namespace read_strategy {
+/// Read the file using the C standard library.
+struct stdio {
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        std::unique_ptr<FILE, decltype(&std::fclose)> f{std::fopen(path.data(), "rb"), std::fclose};
+        if (not f) return errno;
+
+        // Get the file size; if we can’t, e.g. because this is a pipe, read it in chunks.
+        auto end = std::fseek(f.get(), 0, SEEK_END) ? -1 : std::ftell(f.get());
+        if (end < 0 or std::fseek(f.get(), 0, SEEK_SET)) {
+            return detail::read_until_eof(contents, [&](void* buffer, std::size_t size) -> std::int64_t {
+                auto n = std::fread(buffer, 1, size, f.get());
+                return n == 0 and std::ferror(f.get()) ? -1 : std::int64_t(n);
+            });
+        }
+
+        // Read the file.
+        auto sz = std::size_t(end);
+        contents.resize(sz);
+        contents.resize(std::fread(contents.data(), 1, sz, f.get()));
+        if (std::ferror(f.get())) return errno;
+        return 0;
+    }
+};
+
+#if CLOPTS_USE_MMAP
+/// Read the entire file directly into the contents using pread().
+struct pread {
+    static constexpr bool batchable = true;
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        detail::file_descriptor fd{path};
+        auto sz = fd ? fd.size() : -1;
+        if (sz == fd.unknown_size) return fd.read_until_eof(contents);
+        if (sz < 0) return errno;
+
+        contents.resize(std::size_t(sz));
+        auto n = detail::read_at(fd.get(), contents.data(), std::size_t(sz), 0);
+        if (n < 0) return errno;
+        contents.resize(std::size_t(n));
+        return 0;
+    }
+};
+
+/// \brief Map the file and copy the contents out of the mapping.
+///
+/// The template parameters tell the kernel that the file will be read
+/// sequentially (\c MADV_SEQUENTIAL), that it will be read immediately
+/// (\c MADV_WILLNEED), and that it should be backed by huge pages if
+/// possible (\c MADV_HUGEPAGE).
+template <bool sequential = true, bool will_need = false, bool huge_pages = false>
+struct mmap {
+    static constexpr bool batchable = true;
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        detail::file_descriptor fd{path};
+        auto sz = fd ? fd.size() : -1;
+        if (sz == fd.unknown_size) return fd.read_until_eof(contents);
+        if (sz < 0) return errno;
+        if (sz == 0) return 0;
+
+        auto* mem = ::mmap(nullptr, std::size_t(sz), PROT_READ, MAP_PRIVATE, fd.get(), 0);
+        if (mem == MAP_FAILED) return errno;
+
+        // These are only hints, so ignore errors.
+        if constexpr (sequential) ::madvise(mem, std::size_t(sz), MADV_SEQUENTIAL);
+        if constexpr (will_need) ::madvise(mem, std::size_t(sz), MADV_WILLNEED);
+#    ifdef MADV_HUGEPAGE
+        if constexpr (huge_pages) ::madvise(mem, std::size_t(sz), MADV_HUGEPAGE);
+#    endif
+
+        detail::assign_contents(contents, mem, std::size_t(sz));
+        ::munmap(mem, std::size_t(sz));
+        return 0;
+    }
+};
+
+/// Tell the kernel that we’re going to read the whole file sequentially
+/// using posix_fadvise(), and then read it into the contents.
+struct fadvise {
+    static constexpr bool batchable = true;
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        detail::file_descriptor fd{path};
+        auto sz = fd ? fd.size() : -1;
+        if (sz == fd.unknown_size) return fd.read_until_eof(contents);
+        if (sz < 0) return errno;
+
+        ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+        ::posix_fadvise(fd.get(), 0, 0, POSIX_FADV_WILLNEED);
+        contents.resize(std::size_t(sz));
+        auto n = detail::read_at(fd.get(), contents.data(), std::size_t(sz), 0);
+        if (n < 0) return errno;
+        contents.resize(std::size_t(n));
+        return 0;
+    }
+};
+
+#    ifdef O_DIRECT
+/// \brief Read the file with \c O_DIRECT into an aligned buffer, bypassing the page cache.
+///
+/// The data is then copied into the contents. This is useful for large files that
+/// are read once, since they don’t evict anything else from the page cache. Falls
+/// back to \c pread if the file system doesn’t support \c O_DIRECT.
+template <std::size_t alignment = 4096>
+struct direct {
+    static_assert(std::has_single_bit(alignment), "Alignment must be a power of two");
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        detail::file_descriptor fd{path, O_DIRECT};
+        if (not fd and errno == EINVAL) return pread::read(path, contents);
+        auto sz = fd ? fd.size() : -1;
+        if (sz == fd.unknown_size) return fd.read_until_eof(contents);
+        if (sz < 0) return errno;
+        if (sz == 0) return 0;
+
+        // Both the buffer and the size of each read must be aligned.
+        auto rounded = (std::size_t(sz) + alignment - 1) & ~(alignment - 1);
+        auto deleter = [](std::byte* p) { ::operator delete[](p, std::align_val_t{alignment}); };
+        std::unique_ptr<std::byte[], decltype(deleter)> buffer{
+            static_cast<std::byte*>(::operator new[](rounded, std::align_val_t{alignment})),
+            deleter,
+        };
+
+        std::size_t n_read = 0;
+        while (n_read < rounded) {
+            auto n = ::pread(fd.get(), buffer.get() + n_read, rounded - n_read, off_t(n_read));
+            if (n < 0 and errno == EINTR) continue;
+            if (n < 0) return errno;
+            n_read += std::size_t(n);
+
+            // A short read means that we’ve reached the end of the file; don’t
+            // try to read again since the offset is no longer aligned.
+            if (n == 0 or std::size_t(n) % alignment) break;
+        }
+
+        detail::assign_contents(contents, buffer.get(), std::min(n_read, std::size_t(sz)));
+        return 0;
+    }
+};
+#    endif
+
+/// The strategy file<> uses by default.
+using default_strategy = mmap<>;
+#else
+using default_strategy = stdio;
+#endif
+
+/// \brief Refuse to read files that are larger than \c max_bytes.
+///
+/// The size of the file is checked before it is read, so passing a huge file
+/// by accident is an error rather than running out of memory. If \c truncate
+/// is true, only the first \c max_bytes bytes of such files are read instead.
+/// Files that are small enough are read using \c strategy.
+template <std::size_t _max_bytes, bool truncate = false, typename strategy = default_strategy>
+struct max_size {
+    static constexpr std::size_t max_bytes = _max_bytes;
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        {
+#if CLOPTS_USE_MMAP
+            detail::file_descriptor fd{path};
+            auto sz = fd ? fd.size(true) : -1;
+            if (sz == fd.unknown_size or (truncate and sz > std::int64_t(max_bytes))) return fd.read_until_eof(contents, max_bytes, truncate);
+            if (sz < 0) return errno;
+            if (std::uint64_t(sz) > max_bytes) return EFBIG;
+#else
+            std::error_code ec;
+            auto sz = std::filesystem::file_size(path, ec);
+            if (not ec and sz > max_bytes) {
+                if constexpr (not truncate) return EFBIG;
+                std::unique_ptr<FILE, decltype(&std::fclose)> f{std::fopen(path.data(), "rb"), std::fclose};
+                if (not f) return errno;
+                return detail::read_until_eof(contents, [&](void* buffer, std::size_t size) -> std::int64_t {
+                    auto n = std::fread(buffer, 1, size, f.get());
+                    return n == 0 and std::ferror(f.get()) ? -1 : std::int64_t(n);
+                }, max_bytes, truncate);
+            }
+#endif
+        }
+
+        // The file may have grown since we checked.
+        if (int error = strategy::read(path, contents)) return error;
+        if (contents.size() <= max_bytes) return 0;
+        if constexpr (truncate and requires { contents.resize(max_bytes); }) contents.resize(max_bytes);
+        else return EFBIG;
+        return 0;
+    }
+};
+} // namespace read_strategy
+
+/// \brief Contents type for file<> that is aligned and followed by zeroed padding.
+///
+/// This is meant for parsers that read past the end of their input in blocks,
+/// e.g. using SIMD instructions. The \c padding bytes after the contents are
+/// always zero, and can be read even if the buffer is empty. Unlike \c std::string,
+/// \c resize() does not initialise the new contents since file<> always
+/// overwrites them.
+template <std::size_t alignment = 64, std::size_t padding = 64>
+class aligned_buffer {
+    static_assert(std::has_single_bit(alignment), "Alignment must be a power of two");
+
+    /// What data() points to if we haven’t allocated anything yet.
+    alignas(alignment) static inline char empty_buffer[padding + 1]{};
+
+    char* ptr = empty_buffer;
+    std::size_t sz{};
+    std::size_t cap{};
+
+    static void deallocate(char* p) {
+        if (p != empty_buffer) ::operator delete[](p, std::align_val_t{alignment});
+    }
+
+public:
+    using value_type = char;
+    static constexpr std::size_t padding_size = padding;
+
+    aligned_buffer() = default;
+    aligned_buffer(const aligned_buffer& other) { assign(other.ptr, other.sz); }
+    aligned_buffer(aligned_buffer&& other) noexcept { swap(other); }
+    aligned_buffer& operator=(aligned_buffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~aligned_buffer() { deallocate(ptr); }
+
+    /// Replace the contents with a copy of some data.
+    void assign(const char* data, std::size_t size) {
+        resize(0);
+        resize(size);
+        if (size) std::memcpy(ptr, data, size);
+    }
+
+    /// Get the number of bytes we can store without reallocating.
+    [[nodiscard]] auto capacity() const -> std::size_t { return cap; }
+
+    /// Clear the contents, but keep the memory.
+    void clear() { resize(0); }
+
+    /// Get a pointer to the contents.
+    [[nodiscard]] auto data() -> char* { return ptr; }
+    [[nodiscard]] auto data() const -> const char* { return ptr; }
+
+    /// Check if the buffer is empty.
+    [[nodiscard]] bool empty() const { return sz == 0; }
+
+    /// Get the contents followed by the padding.
+    [[nodiscard]] auto padded() const -> std::span<const char> { return {ptr, sz + padding}; }
+
+    /// \brief Change the size of the contents.
+    ///
+    /// If the buffer grows, the existing contents are kept, but the new contents
+    /// are left uninitialised. The padding is zeroed in either case.
+    void resize(std::size_t size) {
+        if (size > cap) {
+            auto* p = static_cast<char*>(::operator new[](size + padding, std::align_val_t{alignment}));
+            if (sz) std::memcpy(p, ptr, sz);
+            deallocate(ptr);
+            ptr = p;
+            cap = size;
+        }
+
+        sz = size;
+        if (ptr != empty_buffer) std::memset(ptr + sz, 0, padding);
+    }
+
+    /// Get the size of the contents, excluding the padding.
+    [[nodiscard]] auto size() const -> std::size_t { return sz; }
+
+    /// Swap two buffers.
+    void swap(aligned_buffer& other) noexcept {
+        std::swap(ptr, other.ptr);
+        std::swap(sz, other.sz);
+        std::swap(cap, other.cap);
+    }
+
+    /// Get the contents as a string.
+    [[nodiscard]] auto view() const -> std::string_view { return {ptr, sz}; }
+
+    /// Compare the contents to a string.
+    [[nodiscard]] friend bool operator==(const aligned_buffer& a, std::string_view b) { return a.view() == b; }
+};
+
+/// \brief Contents of a file that are shared between copies instead of being copied.
+///
+/// Use this as the contents type of a file<> if the same file ends up in many
+/// values, e.g. because \c dedupe_files hands it out to every argument that
+/// names it. Copies share one buffer, which is immutable while it is shared:
+/// modifying a buffer whose contents are shared, which includes calling the
+/// non-const \c data(), first gives it its own copy, so use \c view() to
+/// read the contents.
+class shared_buffer {
+    std::shared_ptr<std::string> buffer;
+
+    /// Make sure we are the only owner of the contents so we can modify them.
+    auto unshare() -> std::string& {
+        if (not buffer) buffer = std::make_shared<std::string>();
+        else if (buffer.use_count() > 1) buffer = std::make_shared<std::string>(*buffer);
+        return *buffer;
+    }
+
+public:
+    using value_type = char;
+
+    /// Replace the contents with a copy of some data.
+    void assign(const char* data, std::size_t size) { unshare().assign(data, size); }
+
+    /// Clear the contents; if they aren’t shared, keep the memory.
+    void clear() {
+        if (buffer.use_count() == 1) buffer->clear();
+        else buffer.reset();
+    }
+
+    /// Get a pointer to the contents.
+    [[nodiscard]] auto data() -> char* { return unshare().data(); }
+    [[nodiscard]] auto data() const -> const char* { return view().data(); }
+
+    /// Check if the buffer is empty.
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    /// Change the size of the contents.
+    void resize(std::size_t size) { unshare().resize(size); }
+
+    /// Get the size of the contents.
+    [[nodiscard]] auto size() const -> std::size_t { return buffer ? buffer->size() : 0; }
+
+    /// Get the contents as a string.
+    [[nodiscard]] auto view() const -> std::string_view { return buffer ? std::string_view{*buffer} : std::string_view{}; }
+
+    /// Access a byte of the contents.
+    [[nodiscard]] auto operator[](std::size_t i) const -> const char& { return view()[i]; }
+
+    /// Compare the contents to a string.
+    [[nodiscard]] friend bool operator==(const shared_buffer& a, std::string_view b) { return a.view() == b; }
+};
+
 /// A file.
-template <typename contents_type_t = std::string, typename path_type_t = std::filesystem::path>
+template <
+    typename contents_type_t = std::string,
+    typename path_type_t = std::filesystem::path,
+    typename read_strategy_t = read_strategy::default_strategy>
 struct file {
     using contents_type = contents_type_t;
     using path_type = path_type_t;
+    using read_strategy = read_strategy_t;
     using element_type = typename contents_type::value_type;
     using element_pointer = std::add_pointer_t<element_type>;
     static constexpr bool is_file_data = true;
 
+    /// The same file type, but with different contents.
+    template <typename other_contents_type>
+    using rebind_contents = file<other_contents_type, path_type_t, read_strategy_t>;
+
     /// The file path.
     path_type path;
 
@@ -1685,6 +5230,403 @@ struct file {
 /// For backwards compatibility.
 using file_data = file<>;
 
+/// A file that is mapped into memory instead of being read.
+///
+/// The mapping is owned by the option values and is unmapped when they
+/// are destroyed.
+template <typename path_type_t = std::filesystem::path>
+struct mapped_file {
+    using path_type = path_type_t;
+    static constexpr bool is_mapped_file = true;
+
+    /// The file path.
+    path_type path;
+
+    /// The mapping.
+    detail::file_mapping mapping;
+
+    /// Get the contents of the file as bytes.
+    [[nodiscard]] auto bytes() const -> std::span<const std::byte> { return mapping.bytes(); }
+
+    /// Get the contents of the file as a string.
+    [[nodiscard]] auto contents() const -> std::string_view { return mapping.view(); }
+};
+
+/// \brief A file that is only read when its contents are first accessed.
+///
+/// The parser only checks that the file exists and is readable. Copies of a
+/// lazy file share its contents, and loading them is thread-safe.
+template <
+    typename contents_type_t = std::string,
+    typename path_type_t = std::filesystem::path,
+    typename read_strategy_t = read_strategy::default_strategy>
+class lazy_file {
+    struct state {
+        std::once_flag once;
+        std::string path;
+        contents_type_t contents;
+        int error = 0;
+    };
+
+    std::shared_ptr<state> st;
+
+    /// Load the file if it hasn’t been loaded yet.
+    void load() const {
+        std::call_once(st->once, [s = st.get()] { s->error = read_strategy_t::read(s->path, s->contents); });
+    }
+
+public:
+    using contents_type = contents_type_t;
+    using path_type = path_type_t;
+    using read_strategy = read_strategy_t;
+    static constexpr bool is_lazy_file = true;
+
+    /// The file path.
+    path_type path;
+
+    lazy_file() = default;
+    explicit lazy_file(std::string_view path)
+        : st{std::make_shared<state>()}, path{path.begin(), path.end()} {
+        st->path = path;
+    }
+
+    /// \brief Get the contents of the file, reading it if this is the first access.
+    ///
+    /// If the file could not be read, the contents are empty; use \c error()
+    /// to find out why.
+    [[nodiscard]] auto contents() const -> const contents_type& {
+        static const contents_type empty{};
+        if (not st) return empty;
+        load();
+        return st->contents;
+    }
+
+    /// Get the value of \c errno if reading the file failed, reading it if this is the first access.
+    [[nodiscard]] int error() const {
+        if (not st) return 0;
+        load();
+        return st->error;
+    }
+};
+
+/// \brief A file that is reloaded whenever it changes.
+///
+/// The file is read at parse time, like a file<>, and then, if
+/// \c CLOPTS_USE_INOTIFY is enabled, reloaded on a background thread whenever
+/// it is written to or replaced; otherwise, it is only loaded once. Each
+/// version of the contents is immutable, and readers that hold on to a version
+/// keep it alive. Copies of a watched file share its contents.
+template <
+    typename contents_type_t = std::string,
+    typename path_type_t = std::filesystem::path,
+    typename read_strategy_t = read_strategy::default_strategy>
+class watched_file {
+public:
+    using contents_type = contents_type_t;
+    using path_type = path_type_t;
+    using read_strategy = read_strategy_t;
+    using callback_type = std::function<void(const contents_type&)>;
+    static constexpr bool is_watched_file = true;
+
+private:
+    template <typename watched_file_type>
+    friend auto detail::open_watched_file(std::string_view, auto) -> watched_file_type;
+
+    struct state : detail::watched_file_state {
+        detail::atomic_shared_ptr<const contents_type> current;
+        std::atomic<std::uint64_t> version = 0;
+        std::atomic<int> error = 0;
+        std::mutex callbacks_mutex;
+        std::vector<callback_type> callbacks;
+
+        using watched_file_state::watched_file_state;
+
+        /// Read the file and publish its contents if they changed.
+        int load() {
+            contents_type contents{};
+            if (int e = read_strategy::read(path, contents)) {
+                error.store(e, std::memory_order_relaxed);
+                return e;
+            }
+
+            error.store(0, std::memory_order_relaxed);
+            if constexpr (requires { contents == contents; }) {
+                auto old = current.load();
+                if (old and *old == contents) return 0;
+            }
+
+            auto published = std::make_shared<const contents_type>(std::move(contents));
+            current.store(published);
+            version.fetch_add(1, std::memory_order_release);
+
+            // Don’t hold the lock while calling the callbacks in case they add more.
+            std::vector<callback_type> to_call;
+            {
+                std::unique_lock lock{callbacks_mutex};
+                to_call = callbacks;
+            }
+
+            for (auto& cb : to_call) cb(*published);
+            return 0;
+        }
+
+        void reload() override { load(); }
+    };
+
+    std::shared_ptr<state> st;
+
+    /// Start watching the file and load it.
+    int start() {
+#if CLOPTS_USE_INOTIFY
+        // Watch the file first so we don’t miss changes made while we load it.
+        if (int error = detail::file_watcher::instance().add(st)) return error;
+#endif
+        return st->load();
+    }
+
+public:
+    /// The file path.
+    path_type path;
+
+    watched_file() = default;
+    explicit watched_file(std::string_view path)
+        : st{std::make_shared<state>(path)}, path{path.begin(), path.end()} {}
+
+    /// \brief Get the current contents of the file.
+    ///
+    /// The contents stay valid for as long as the returned pointer is alive,
+    /// even if the file is reloaded in the meantime. If you read the contents
+    /// in a hot loop, check \c version() first and only call this if it has
+    /// changed.
+    [[nodiscard]] auto contents() const -> std::shared_ptr<const contents_type> {
+        if (not st) return {};
+        return st->current.load();
+    }
+
+    /// \brief Get the value of \c errno if the last attempt to reload the file failed.
+    ///
+    /// If reloading fails, e.g. because the file was deleted, the previous
+    /// contents are kept.
+    [[nodiscard]] int error() const { return st ? st->error.load(std::memory_order_relaxed) : 0; }
+
+    /// \brief Call a function whenever the contents of the file change.
+    ///
+    /// The callback is called on the thread that watches the file and is
+    /// passed the new contents; it is not called if the file is rewritten
+    /// with the same contents.
+    void on_change(callback_type callback) {
+        if (not st) return;
+        std::unique_lock lock{st->callbacks_mutex};
+        st->callbacks.push_back(std::move(callback));
+    }
+
+    /// \brief Get how many times the contents have been loaded.
+    ///
+    /// This starts at 1 and is incremented every time the contents change,
+    /// so it is a cheap way to check whether anything derived from them
+    /// needs to be rebuilt.
+    [[nodiscard]] auto version() const -> std::uint64_t { return st ? st->version.load(std::memory_order_acquire) : 0; }
+};
+
+/// \brief A file that is mapped into memory and split into lines.
+///
+/// The lines point into the mapping and don’t include the line break; a
+/// trailing \c \\r is dropped too, so files with Windows line endings work
+/// as expected.
+template <typename path_type_t = std::filesystem::path>
+class lines {
+    std::vector<std::size_t> ends;
+
+public:
+    using path_type = path_type_t;
+    static constexpr bool is_lines = true;
+
+    /// Iterator over the lines.
+    class iterator {
+        const lines* l{};
+        std::size_t i{};
+
+    public:
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(const lines* l, std::size_t i) : l{l}, i{i} {}
+
+        auto operator*() const -> std::string_view { return (*l)[i]; }
+        auto operator++() -> iterator& {
+            i++;
+            return *this;
+        }
+
+        auto operator++(int) -> iterator {
+            auto tmp = *this;
+            i++;
+            return tmp;
+        }
+
+        bool operator==(const iterator&) const = default;
+    };
+
+    /// The file path.
+    path_type path;
+
+    /// The mapping.
+    detail::file_mapping mapping;
+
+    lines() = default;
+    lines(path_type path, detail::file_mapping m) : path{std::move(path)}, mapping{std::move(m)} {
+        auto text = mapping.view();
+        ends.reserve(text.size() / 64);
+        detail::for_each_occurrence<'\n'>(text, [&](std::size_t pos) { ends.push_back(pos); });
+        if (not text.empty() and text.back() != '\n') ends.push_back(text.size());
+    }
+
+    /// Get a line.
+    [[nodiscard]] auto operator[](std::size_t i) const -> std::string_view {
+        auto start = i == 0 ? 0 : ends[i - 1] + 1;
+        auto line = mapping.view().substr(start, ends[i] - start);
+        if (line.ends_with('\r')) line.remove_suffix(1);
+        return line;
+    }
+
+    /// Iterate over the lines.
+    [[nodiscard]] auto begin() const -> iterator { return {this, 0}; }
+    [[nodiscard]] auto end() const -> iterator { return {this, ends.size()}; }
+
+    /// Get the contents of the entire file.
+    [[nodiscard]] auto contents() const -> std::string_view { return mapping.view(); }
+
+    /// Check if there are no lines.
+    [[nodiscard]] bool empty() const { return ends.empty(); }
+
+    /// Get the number of lines.
+    [[nodiscard]] auto size() const -> std::size_t { return ends.size(); }
+};
+
+/// \brief A file that is read in chunks instead of all at once.
+///
+/// This can read pipes, stdin (the path \c -), and files that don’t fit in
+/// memory. Each chunk is read into the same buffer, so reading a stream only
+/// needs \c chunk_size bytes of memory.
+template <std::size_t _chunk_size = 1 << 20, typename path_type_t = std::filesystem::path>
+class stream {
+    static_assert(_chunk_size > 0, "Chunk size must not be 0");
+
+    detail::stream_handle handle;
+    std::unique_ptr<char[]> buffer;
+    int err = 0;
+    bool at_end = false;
+
+public:
+    using path_type = path_type_t;
+    static constexpr std::size_t chunk_size = _chunk_size;
+    static constexpr bool is_stream = true;
+
+    /// The file path.
+    path_type path;
+
+    stream() = default;
+    stream(std::string_view path, detail::stream_handle handle)
+        : handle{std::move(handle)}, path{path.begin(), path.end()} {}
+
+    /// \brief Read the next chunk of the file.
+    ///
+    /// This returns as soon as some data is available, so a chunk may be
+    /// smaller than \c chunk_size even if it isn’t the last one. The chunk
+    /// is only valid until the next call to \c next().
+    ///
+    /// \return The chunk, or an empty string at the end of the file or on error.
+    auto next() -> std::string_view {
+        if (at_end) return {};
+        if (not buffer) buffer = std::make_unique_for_overwrite<char[]>(chunk_size);
+        auto n = handle.read(buffer.get(), chunk_size);
+        if (n <= 0) {
+            if (n < 0) err = errno;
+            at_end = true;
+            return {};
+        }
+
+        return {buffer.get(), std::size_t(n)};
+    }
+
+    /// Same as \c next(), but returns the chunk as bytes.
+    auto next_bytes() -> std::span<const std::byte> {
+        auto chunk = next();
+        return {reinterpret_cast<const std::byte*>(chunk.data()), chunk.size()};
+    }
+
+    /// Check if we’ve reached the end of the file or an error occurred.
+    [[nodiscard]] bool eof() const { return at_end; }
+
+    /// Get the value of \c errno if reading the file failed, or 0.
+    [[nodiscard]] int error() const { return err; }
+};
+
+/// \brief A file that the program writes to.
+///
+/// The file is created during parsing, so the program finds out that it can’t
+/// write to it before it does any work. If it already exists, it is only
+/// truncated once \c parse() has succeeded without errors, or otherwise when
+/// it is first written to, so its contents survive if e.g. a later argument
+/// is invalid. The
+/// file is closed when the option value is destroyed, but call \c close() if
+/// you want to know whether all writes succeeded.
+///
+/// \tparam _size_hint How many bytes to reserve on disk for the file, or 0.
+/// \tparam _buffer_size The size of the write buffer.
+template <
+    std::size_t _size_hint = 0,
+    std::size_t _buffer_size = 1 << 20,
+    typename path_type_t = std::filesystem::path>
+class output_file {
+    static_assert(_buffer_size > 0, "Buffer size must not be 0");
+
+    detail::output_handle handle;
+
+    template <typename...>
+    friend class detail::clopts_impl;
+
+public:
+    using path_type = path_type_t;
+    static constexpr std::size_t size_hint = _size_hint;
+    static constexpr std::size_t buffer_size = _buffer_size;
+    static constexpr bool is_output_file = true;
+
+    /// The file path.
+    path_type path;
+
+    output_file() = default;
+    output_file(std::string_view path, detail::output_handle handle)
+        : handle{std::move(handle)}, path{path.begin(), path.end()} {}
+
+    /// \brief Flush the buffer and close the file.
+    ///
+    /// \return The value of \c errno if any write failed, or 0.
+    int close() { return handle.close(); }
+
+    /// Get the value of \c errno if a write failed, or 0.
+    [[nodiscard]] int error() const { return handle.error(); }
+
+    /// Write the contents of the buffer to the file.
+    void flush() { handle.flush(); }
+
+    /// \brief Resize the file and map it into memory.
+    ///
+    /// Writes to the mapping go straight to the file. The mapping is valid
+    /// until the next call to \c map() or until the file is closed. Don’t
+    /// mix this with \c write().
+    ///
+    /// \return The mapping, or an empty span on error.
+    auto map(std::size_t size) -> std::span<std::byte> { return handle.map(size); }
+
+    /// Write a string to the file.
+    void write(std::string_view data) { handle.write(data.data(), data.size()); }
+
+    /// Write bytes to the file.
+    void write(std::span<const std::byte> data) { handle.write(reinterpret_cast<const char*>(data.data()), data.size()); }
+};
+
 /// A positional option.
 ///
 /// Positional options cannot be overridable; use multiple<positional<>>
@@ -1754,6 +5696,55 @@ struct stop_parsing : option<stop_at, "Stop parsing command-line arguments", det
     static constexpr bool is_stop_parsing = true;
 };
 
+/// \brief Load file<> options on several threads once all arguments have been processed.
+///
+/// \tparam threads The maximum number of threads to use; 0 means one per core.
+template <std::size_t threads = 0>
+struct parallel_file_loading {
+    using canonical_type = detail::special_tag;
+    static constexpr std::size_t file_loading_threads = threads;
+    constexpr parallel_file_loading() = delete;
+};
+
+/// Only convert the value of the last occurrence of each overridable option.
+struct defer_overrides {
+    using canonical_type = detail::special_tag;
+    static constexpr bool is_defer_overrides = true;
+    constexpr defer_overrides() = delete;
+};
+
+/// \brief Only load each file once per parse, even if it is passed several times.
+///
+/// Files are identified by their device, inode, and modification time, so
+/// this also catches symlinks and hard links.
+struct dedupe_files {
+    using canonical_type = detail::special_tag;
+    static constexpr bool is_dedupe_files = true;
+    constexpr dedupe_files() = delete;
+};
+
+/// \brief Replace arguments of the form \c @file with the arguments in that file.
+///
+/// \tparam max_depth How deeply response files may include each other.
+template <std::size_t max_depth = 16>
+struct response_files {
+    static_assert(max_depth > 0, "Maximum depth must not be 0");
+    using canonical_type = detail::special_tag;
+    static constexpr std::size_t response_file_depth = max_depth;
+    constexpr response_files() = delete;
+};
+
+/// \brief Limit the total number of bytes that file<> options may load per parse.
+///
+/// The size of each file is checked before it is loaded; an error is reported
+/// for the first file that no longer fits.
+template <std::size_t bytes>
+struct file_budget {
+    using canonical_type = detail::special_tag;
+    static constexpr std::size_t file_budget_bytes = bytes;
+    constexpr file_budget() = delete;
+};
+
 } // namespace command_line_options
 
 #undef CLOPTS_STRLEN
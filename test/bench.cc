@@ -0,0 +1,287 @@
+#include "../include/clopts.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace command_line_options;
+
+/// Count allocations so we can tell how many a parse performs.
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t sz) {
+    allocations++;
+    if (auto p = std::malloc(sz)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static bool error_handler(std::string&& s) {
+    std::fprintf(stderr, "%s\n", s.c_str());
+    std::exit(1);
+}
+
+/// Run a benchmark a few times and print the fastest run.
+template <typename callable>
+static void bench(const char* name, std::size_t items, callable run) {
+    using namespace std::chrono;
+    constexpr int iterations = 5;
+    auto best = duration<double>::max();
+    for (int i = 0; i < iterations; i++) {
+        auto start = steady_clock::now();
+        run();
+        best = std::min(best, duration<double>(steady_clock::now() - start));
+    }
+
+    std::printf(
+        "%-48s %10.3f ms  %8.2f M items/s\n",
+        name,
+        best.count() * 1e3,
+        double(items) / best.count() / 1e6
+    );
+}
+
+static void bench_integers() {
+    using options = clopts<multiple<option<"--int", "", int64_t>>>;
+    constexpr std::size_t count = 1'000'000;
+
+    std::vector<std::string> storage;
+    storage.reserve(count);
+    for (std::size_t i = 0; i < count; i++) storage.push_back(std::to_string(std::int64_t(i) * 7919 - 4'000'000'000));
+
+    std::vector<const char*> args{"bench"};
+    for (auto& s : storage) {
+        args.push_back("--int");
+        args.push_back(s.c_str());
+    }
+
+    bench("parse 1M multiple<int64_t> values", count, [&] {
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.get<"--int">().size() != count) std::exit(1);
+    });
+
+    bench("detail::to_number() on 1M integers", count, [&] {
+        std::int64_t sum = 0, i = 0;
+        for (auto& s : storage) {
+            (void) detail::to_number(s, i);
+            sum += i;
+        }
+        if (sum == 42) std::exit(1);
+    });
+
+    bench("std::strtoll() on 1M integers", count, [&] {
+        std::int64_t sum = 0;
+        for (auto& s : storage) sum += std::strtoll(s.c_str(), nullptr, 10);
+        if (sum == 42) std::exit(1);
+    });
+}
+
+template <typename string_type>
+static void bench_positional(const char* name) {
+    using options = clopts<multiple<positional<"paths", "", string_type>>>;
+    constexpr std::size_t count = 50'000;
+
+    std::vector<std::string> storage;
+    storage.reserve(count);
+    for (std::size_t i = 0; i < count; i++) storage.push_back("/some/rather/long/path/to/a/source/file/" + std::to_string(i) + ".cc");
+
+    std::vector<const char*> args{"bench"};
+    for (auto& s : storage) args.push_back(s.c_str());
+
+    bench(name, count, [&] {
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.template get<"paths">().size() != count) std::exit(1);
+    });
+}
+
+static void bench_reuse() {
+    using options = clopts<
+        option<"--name", "">,
+        option<"--mode", "", values<"fast", "slow">>,
+        option<"--level", "", int64_t>,
+        flag<"--verbose", "">,
+        multiple<option<"--tag", "", std::string_view>>,
+        multiple<positional<"paths", "", std::string_view>>>;
+
+    std::array args = {
+        "bench",
+        "--name", "a-request-name-that-does-not-fit-inline",
+        "--mode=fast",
+        "--level", "3",
+        "--verbose",
+        "--tag", "foo",
+        "--tag", "bar",
+        "/path/to/a",
+        "/path/to/b",
+        "/path/to/c",
+    };
+
+    constexpr std::size_t count = 100'000;
+    bench("100k cold parses", count, [&] {
+        for (std::size_t i = 0; i < count; i++) (void) options::parse(int(args.size()), args.data(), error_handler);
+    });
+
+    options::parser parser{error_handler};
+    bench("100k warm parses (options::parser)", count, [&] {
+        for (std::size_t i = 0; i < count; i++) (void) parser.parse(int(args.size()), args.data());
+    });
+
+    // The same arguments as a single string that has to be split first.
+    constexpr std::string_view command_line = "bench --name 'a-request-name-that-does-not-fit-inline' --mode=fast --level 3 "
+                                              "--verbose --tag foo --tag \"bar\" /path/to/a /path/to/b /path/to/c";
+    bench("100k warm parses (parse_command_line())", count, [&] {
+        for (std::size_t i = 0; i < count; i++) (void) parser.parse_command_line(command_line);
+    });
+
+    auto before = allocations;
+    (void) options::parse(int(args.size()), args.data(), error_handler);
+    auto cold = allocations - before;
+    before = allocations;
+    (void) parser.parse(int(args.size()), args.data());
+    auto warm = allocations - before;
+    before = allocations;
+    (void) parser.parse_command_line(command_line);
+    auto split = allocations - before;
+    std::printf("allocations per parse: %zu cold, %zu warm, %zu warm from a string\n", cold, warm, split);
+}
+
+template <template <typename, detail::static_string...> typename reference>
+static void bench_references(const char* name) {
+    using options = clopts<
+        multiple<option<"-I", "", std::string_view>>,
+        multiple<option<"--file", "", reference<std::string_view, "-I">>>>;
+    constexpr std::size_t count = 5'000;
+
+    // Every file sees all include directories that precede it.
+    std::vector<const char*> args{"bench"};
+    for (std::size_t i = 0; i < count; i++) {
+        args.push_back("-I");
+        args.push_back("/usr/include");
+        args.push_back("--file");
+        args.push_back("main.cc");
+    }
+
+    bench(name, count, [&] {
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (std::ranges::size(opts.template get<"--file">()) != count) std::exit(1);
+    });
+}
+
+static void bench_files() {
+    constexpr std::size_t size = 64 << 20;
+    auto path = std::filesystem::temp_directory_path() / "clopts-bench-file";
+    {
+        std::string data(size, 'x');
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (not f or std::fwrite(data.data(), 1, data.size(), f) != data.size()) std::exit(1);
+        std::fclose(f);
+    }
+
+    std::array args = {"bench", "--file", path.c_str()};
+    bench("parse file<> (64 MiB)", 1, [&] {
+        using options = clopts<option<"--file", "", file<>>>;
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.get<"--file">()->contents.size() != size) std::exit(1);
+    });
+
+    bench("parse mapped_file<> (64 MiB)", 1, [&] {
+        using options = clopts<option<"--file", "", mapped_file<>>>;
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.get<"--file">()->contents().size() != size) std::exit(1);
+    });
+
+    bench("parse lazy_file<> (64 MiB) without reading it", 1, [&] {
+        using options = clopts<option<"--file", "", lazy_file<>>>;
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (not opts.get<"--file">()) std::exit(1);
+    });
+
+    std::filesystem::remove(path);
+}
+
+static void bench_lines() {
+    constexpr std::size_t count = 1'000'000;
+    auto path = std::filesystem::temp_directory_path() / "clopts-bench-lines";
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (not f) std::exit(1);
+        for (std::size_t i = 0; i < count; i++) std::fprintf(f, "src/some/directory/file_%07zu.cc\n", i);
+        std::fclose(f);
+    }
+
+    std::array args = {"bench", "--list", path.c_str()};
+    bench("parse lines<> (1M lines)", count, [&] {
+        using options = clopts<option<"--list", "", lines<>>>;
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.get<"--list">()->size() != count) std::exit(1);
+    });
+
+    std::filesystem::remove(path);
+}
+
+static void bench_response_file() {
+    constexpr std::size_t count = 100'000;
+    auto path = std::filesystem::temp_directory_path() / "clopts-bench-response-file";
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        if (not f) std::exit(1);
+        for (std::size_t i = 0; i < count; i++) std::fprintf(f, i % 10 ? "src/some/directory/file_%06zu.cc\n" : "\"src/a directory/file_%06zu.cc\"\n", i);
+        std::fclose(f);
+    }
+
+    auto arg = "@" + path.string();
+    std::array args = {"bench", arg.c_str()};
+    bench("parse 100k std::string_view paths from a response file", count, [&] {
+        using options = clopts<multiple<positional<"inputs", "", std::string_view>>, response_files<>>;
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.get<"inputs">().size() != count) std::exit(1);
+    });
+
+    std::filesystem::remove(path);
+}
+
+template <typename... special>
+static void bench_many_files(const char* name) {
+    using options = clopts<multiple<positional<"inputs", "", file<>>>, special...>;
+    constexpr std::size_t count = 256;
+    constexpr std::size_t size = 1 << 20;
+
+    // Create the files.
+    auto dir = std::filesystem::temp_directory_path() / "clopts-bench-files";
+    std::filesystem::create_directories(dir);
+    std::vector<std::string> paths;
+    std::string data(size, 'x');
+    for (std::size_t i = 0; i < count; i++) {
+        paths.push_back((dir / std::to_string(i)).string());
+        std::FILE* f = std::fopen(paths.back().c_str(), "wb");
+        if (not f or std::fwrite(data.data(), 1, data.size(), f) != data.size()) std::exit(1);
+        std::fclose(f);
+    }
+
+    std::vector<const char*> args{"bench"};
+    for (auto& p : paths) args.push_back(p.c_str());
+    bench(name, count, [&] {
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        if (opts.template get<"inputs">().back().contents.size() != size) std::exit(1);
+    });
+
+    std::filesystem::remove_all(dir);
+}
+
+int main() {
+    bench_integers();
+    bench_positional<std::string>("parse 50k positional std::string paths");
+    bench_positional<std::string_view>("parse 50k positional std::string_view paths");
+    bench_reuse();
+    bench_references<ref>("5k ref<> over a growing multiple<>");
+    bench_references<snapshot_ref>("5k snapshot_ref<> over a growing multiple<>");
+    bench_files();
+    bench_lines();
+    bench_response_file();
+    bench_many_files("parse 256 file<>s (1 MiB each)");
+    bench_many_files<parallel_file_loading<>>("parse 256 file<>s with parallel_file_loading<>");
+}
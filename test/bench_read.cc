@@ -0,0 +1,122 @@
+/// Compare the read strategies of file<> on a cold and warm page cache.
+///
+/// Usage: bench_read [size...]
+///
+/// Sizes may have a K, M, or G suffix; the default is 4K 64K 1M 16M 256M.
+/// The files are created in $CLOPTS_BENCH_DIR, or the temporary directory
+/// if that is not set; make sure it is on a real file system, since tmpfs
+/// has no page cache to speak of and doesn’t support O_DIRECT.
+#include "../include/clopts.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace command_line_options;
+
+#if !CLOPTS_USE_MMAP
+int main() {
+    std::puts("Read strategies other than read_strategy::stdio are only supported on Linux");
+}
+#else
+static bool error_handler(std::string&& s) {
+    std::fprintf(stderr, "%s\n", s.c_str());
+    std::exit(1);
+}
+
+/// Evict a file from the page cache.
+static void drop_cache(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) std::exit(1);
+    ::fdatasync(fd);
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+/// Parse a size such as '4K' or '1G'.
+static auto parse_size(std::string_view s) -> std::size_t {
+    std::size_t shift = 0;
+    switch (s.empty() ? 0 : s.back()) {
+        case 'K': shift = 10; break;
+        case 'M': shift = 20; break;
+        case 'G': shift = 30; break;
+    }
+
+    if (shift) s.remove_suffix(1);
+    std::int64_t n{};
+    if (detail::to_number(s, n) != std::errc{} or n <= 0) {
+        std::fprintf(stderr, "Invalid size: '%.*s'\n", int(s.size()), s.data());
+        std::exit(1);
+    }
+
+    return std::size_t(n) << shift;
+}
+
+/// Create a file of a given size.
+static void create_file(const std::filesystem::path& path, std::size_t size) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (not f) std::exit(1);
+    std::string chunk(std::min<std::size_t>(size, 1 << 20), 'x');
+    for (std::size_t written = 0; written < size; written += chunk.size())
+        std::fwrite(chunk.data(), 1, std::min(chunk.size(), size - written), f);
+    std::fclose(f);
+}
+
+/// Time parsing a file with a read strategy and print the fastest run.
+template <typename strategy>
+static void bench(const char* name, const std::filesystem::path& path, std::size_t size, bool cold) {
+    using namespace std::chrono;
+    using options = clopts<option<"--file", "", file<std::string, std::filesystem::path, strategy>>>;
+    std::array args = {"bench", "--file", path.c_str()};
+
+    // Make sure the file is in the page cache for warm runs.
+    if (not cold) (void) options::parse(int(args.size()), args.data(), error_handler);
+
+    constexpr int iterations = 5;
+    auto best = duration<double>::max();
+    for (int i = 0; i < iterations; i++) {
+        if (cold) drop_cache(path);
+        auto start = steady_clock::now();
+        auto opts = options::parse(int(args.size()), args.data(), error_handler);
+        best = std::min(best, duration<double>(steady_clock::now() - start));
+        if (opts.template get<"--file">()->contents.size() != size) std::exit(1);
+    }
+
+    std::printf(
+        "%-8s %-5s %-28s %10.3f ms  %8.2f GiB/s\n",
+        (std::to_string(size >> 10) + "K").c_str(),
+        cold ? "cold" : "warm",
+        name,
+        best.count() * 1e3,
+        double(size) / best.count() / double(1 << 30)
+    );
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::size_t> sizes;
+    for (int i = 1; i < argc; i++) sizes.push_back(parse_size(argv[i]));
+    if (sizes.empty()) sizes = {4 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20};
+
+    auto* dir = std::getenv("CLOPTS_BENCH_DIR");
+    auto path = (dir ? std::filesystem::path{dir} : std::filesystem::temp_directory_path()) / "clopts-bench-read";
+    for (auto size : sizes) {
+        create_file(path, size);
+        for (bool cold : {true, false}) {
+            bench<read_strategy::stdio>("stdio", path, size, cold);
+            bench<read_strategy::pread>("pread", path, size, cold);
+            bench<read_strategy::mmap<false>>("mmap", path, size, cold);
+            bench<read_strategy::mmap<>>("mmap (sequential)", path, size, cold);
+            bench<read_strategy::mmap<true, true>>("mmap (sequential, willneed)", path, size, cold);
+            bench<read_strategy::mmap<true, true, true>>("mmap (all hints)", path, size, cold);
+            bench<read_strategy::fadvise>("fadvise", path, size, cold);
+#    ifdef O_DIRECT
+            bench<read_strategy::direct<>>("O_DIRECT", path, size, cold);
+#    endif
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+#endif
@@ -1,3 +1,22 @@
+#if CLOPTS_USE_IO_URING
+#    include <cerrno>
+#    include <sys/syscall.h>
+#    include <unistd.h>
+
+// Lets tests make io_uring_enter() fail once after this many more calls.
+static int io_uring_enter_calls_until_failure = -1;
+static long io_uring_enter_or_fail(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    if (io_uring_enter_calls_until_failure >= 0 and io_uring_enter_calls_until_failure-- == 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return ::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+#    define CLOPTS_IO_URING_ENTER(fd, to_submit, min_complete, flags) io_uring_enter_or_fail(fd, to_submit, min_complete, flags)
+#endif
+
 #include "../include/clopts.hh"
 
 #include <catch2/catch_all.hpp>
@@ -113,6 +132,48 @@ TEST_CASE("Setting a custom error handler works") {
     CHECK(called);
 }
 
+TEST_CASE("Error handlers can take a parse_error") {
+    using options = clopts<
+        option<"--int", "An integer", int64_t>,
+        option<"--required", "A required option", std::string, true>,
+        option<"--string", "A string">>;
+
+    std::vector<parse_error> errors;
+    std::vector<std::string> messages;
+    auto handler = [&](const parse_error& e) {
+        errors.push_back(e);
+        messages.push_back(e.message());
+        return true;
+    };
+
+    std::array args = {"test", "--int", "abc", "--foo", "--string"};
+    options::parse(args.size(), args.data(), handler);
+
+    REQUIRE(errors.size() == 4);
+    CHECK(errors[0].kind == error_kind::invalid_number);
+    CHECK(errors[0].option == "--int");
+    CHECK(errors[0].argument == "abc");
+    CHECK(errors[0].option_index == 0);
+    CHECK(errors[0].argument_index == 2);
+    CHECK(messages[0] == "abc does not appear to be a valid integer");
+
+    CHECK(errors[1].kind == error_kind::unrecognised_option);
+    CHECK(errors[1].argument == "--foo");
+    CHECK(errors[1].option_index == parse_error::npos);
+    CHECK(errors[1].argument_index == 3);
+    CHECK(messages[1] == "Unrecognized option: \"--foo\"");
+
+    CHECK(errors[2].kind == error_kind::missing_argument);
+    CHECK(errors[2].option_index == 2);
+    CHECK(errors[2].argument_index == 4);
+    CHECK(messages[2] == "Missing argument for option \"--string\"");
+
+    CHECK(errors[3].kind == error_kind::missing_required_option);
+    CHECK(errors[3].option_index == 1);
+    CHECK(errors[3].argument_index == -1);
+    CHECK(messages[3] == "Option \"--required\" is required");
+}
+
 TEST_CASE("values<> option type is handled properly") {
     using int_options = clopts<option<"--values", "A values option", values<0, 1, 2, 3>>>;
     using string_options = clopts<option<"--values", "A values option", values<"foo", "bar", "baz">>>;
@@ -218,6 +279,43 @@ TEST_CASE("Positional and non-positional options mix properly") {
     CHECK(*opts.get<"--float">() == 3.141592653589_a);
 }
 
+TEST_CASE("Positional options are filled in declaration order") {
+    using options = clopts<
+        positional<"first", "The first positional argument", std::string, false>,
+        flag<"--flag", "A flag">,
+        positional<"second", "The second positional argument", std::string, false>,
+        multiple<positional<"rest", "The remaining arguments", std::string, false>>>;
+
+    std::array args = {
+        "test",
+        "a",
+        "b",
+        "--flag",
+        "c",
+        "-",
+        "",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"first">());
+    REQUIRE(opts.get<"second">());
+    CHECK(*opts.get<"first">() == "a");
+    CHECK(*opts.get<"second">() == "b");
+    CHECK(opts.get<"--flag">());
+
+    auto rest = opts.get<"rest">();
+    REQUIRE(rest.size() == 3);
+    CHECK(rest[0] == "c");
+    CHECK(rest[1] == "-");
+    CHECK(rest[2] == "");
+
+    SECTION("and extra positional arguments are an error") {
+        using options2 = clopts<positional<"first", "The first positional argument">>;
+        std::array args2 = {"test", "a", "b"};
+        CHECK_THROWS(options2::parse(args2.size(), args2.data(), error_handler));
+    }
+}
+
 TEST_CASE("Positional options are required by default") {
     using options = clopts<positional<"first", "The first positional argument">>;
     CHECK_THROWS(options::parse(0, nullptr, error_handler));
@@ -312,6 +410,96 @@ TEST_CASE("Short option options are parsed properly") {
     CHECK(*opts.get<"-f">() == 3.141592653589_a);
 }
 
+TEST_CASE("Options that share a prefix are dispatched correctly") {
+    using options = clopts<
+        option<"--foo", "Foo", std::string>,
+        option<"--foobar", "Foobar", std::string>,
+        flag<"--foo-flag", "Flag">,
+        option<"--f", "F", int64_t>>;
+
+    std::array args = {
+        "test",
+        "--foobar=a",
+        "--foo",
+        "b",
+        "--foo-flag",
+        "--f=3",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"--foo">());
+    REQUIRE(opts.get<"--foobar">());
+    REQUIRE(opts.get<"--f">());
+    CHECK(*opts.get<"--foobar">() == "a");
+    CHECK(*opts.get<"--foo">() == "b");
+    CHECK(opts.get<"--foo-flag">());
+    CHECK(*opts.get<"--f">() == 3);
+
+    std::array flag_with_value = {"test", "--foo-flag=x"};
+    CHECK_THROWS(options::parse(flag_with_value.size(), flag_with_value.data(), error_handler));
+}
+
+TEST_CASE("Short options with glued values are matched against the longest name") {
+    using options = clopts<
+        experimental::short_option<"-O", "Optimisation level", int64_t>,
+        experimental::short_option<"-I", "Include path", std::string, false, true>,
+        option<"--output", "Output file">,
+        option<"--out", "Other output file">>;
+
+    std::array args = {
+        "test",
+        "-O3",
+        "-Ifoo",
+        "-I",
+        "bar",
+        "-I=baz",
+        "--output=x",
+        "--out=y",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"-O">());
+    REQUIRE(opts.get<"--output">());
+    REQUIRE(opts.get<"--out">());
+    CHECK(*opts.get<"-O">() == 3);
+    CHECK(*opts.get<"--output">() == "x");
+    CHECK(*opts.get<"--out">() == "y");
+
+    REQUIRE(opts.get<"-I">());
+    CHECK(*opts.get<"-I">() == "baz");
+
+    std::array separate = {"test", "-Ifoo", "-I", "bar"};
+    auto opts2 = options::parse(separate.size(), separate.data(), error_handler);
+    REQUIRE(opts2.get<"-I">());
+    CHECK(*opts2.get<"-I">() == "bar");
+
+    std::array unknown = {"test", "--outp=z"};
+    CHECK_THROWS(options::parse(unknown.size(), unknown.data(), error_handler));
+}
+
+static constexpr std::array<std::pair<std::string_view, std::size_t>, 3> trie_names{{
+    {"-I", 2},
+    {"-Ia", 0},
+    {"-Iab", 1},
+}};
+
+static constexpr detail::option_name_trie<3, detail::count_trie_nodes(trie_names)> name_trie{trie_names};
+static_assert(detail::count_trie_nodes(trie_names) == 5);
+static_assert(name_trie.longest_prefix("-Iabc", [](auto, auto) { return true; }) == 1);
+static_assert(name_trie.longest_prefix("-Iac", [](auto, auto) { return true; }) == 0);
+static_assert(name_trie.longest_prefix("-Iab", [](auto i, auto) { return i != 1; }) == 0);
+static_assert(name_trie.longest_prefix("-J", [](auto, auto) { return true; }) == std::size_t(-1));
+
+static constexpr detail::option_name_table<3> name_table{
+    std::array{"--a"sv, "--b"sv, "c"sv},
+    std::array{true, true, false},
+};
+
+static_assert(name_table.find("--a") == 0);
+static_assert(name_table.find("--b") == 1);
+static_assert(name_table.find("c") == 3);
+static_assert(name_table.find("--") == 3);
+
 TEST_CASE("Empty option value is handled correctly") {
     std::array args = {"test", "--empty="};
 
@@ -352,6 +540,61 @@ TEST_CASE("Integer overflow is an error") {
     CHECK_THROWS(options::parse(args.size(), args.data(), error_handler));
 }
 
+TEST_CASE("Numbers are parsed correctly") {
+    using options = clopts<
+        multiple<option<"--int", "Integers", int64_t>>,
+        multiple<option<"--float", "Floats", double>>>;
+
+    std::array args = {
+        "test",
+        "--int", "-42",
+        "--int", "+42",
+        "--int", "9223372036854775807",
+        "--int", "-9223372036854775808",
+        "--float", "-1.5",
+        "--float", "1e3",
+        "--float", "0x1p4",
+        "--float", "-0x1.8p1",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    auto ints = opts.get<"--int">();
+    auto floats = opts.get<"--float">();
+    REQUIRE(ints.size() == 4);
+    REQUIRE(floats.size() == 4);
+    CHECK(ints[0] == -42);
+    CHECK(ints[1] == 42);
+    CHECK(ints[2] == std::numeric_limits<int64_t>::max());
+    CHECK(ints[3] == std::numeric_limits<int64_t>::min());
+    CHECK(floats[0] == -1.5);
+    CHECK(floats[1] == 1000.0);
+    CHECK(floats[2] == 16.0);
+    CHECK(floats[3] == -3.0);
+
+    for (auto invalid : {"-9223372036854775809", "18446744073709551615", "12a", " 1", "+-1", "0x10", "1.5"}) {
+        std::array invalid_args = {"test", "--int", invalid};
+        CHECK_THROWS(options::parse(invalid_args.size(), invalid_args.data(), error_handler));
+    }
+
+    for (auto invalid : {"1e999", "1.5x", "x", "0x", "0x-1"}) {
+        std::array invalid_args = {"test", "--float", invalid};
+        CHECK_THROWS(options::parse(invalid_args.size(), invalid_args.data(), error_handler));
+    }
+}
+
+TEST_CASE("Numbers can be parsed from any slice of a string") {
+    std::string_view buffer = "123,456.5,789";
+    int64_t i{};
+    double d{};
+
+    CHECK(detail::to_number(buffer.substr(0, 3), i) == std::errc{});
+    CHECK(i == 123);
+    CHECK(detail::to_number(buffer.substr(4, 5), d) == std::errc{});
+    CHECK(d == 456.5);
+    CHECK(detail::to_number(buffer.substr(0, 4), i) == std::errc::invalid_argument);
+    CHECK(detail::to_number("99999999999999999999"sv, i) == std::errc::result_out_of_range);
+}
+
 TEST_CASE("Multiple meta-option") {
     using options = clopts<
         multiple<option<"--int", "Integers", int64_t, true>>,
@@ -414,6 +657,37 @@ TEST_CASE("Multiple + Positional works") {
     CHECK(opts.get<"rest">()[1] == "qux");
 }
 
+TEST_CASE("std::string_view options point into argv") {
+    using options = clopts<
+        option<"--view", "A string view", std::string_view>,
+        multiple<option<"--views", "String views", std::string_view>>,
+        multiple<positional<"rest", "The remaining arguments", std::string_view, false>>>;
+
+    std::array args = {
+        "test",
+        "--view=foo",
+        "--views",
+        "bar",
+        "baz",
+        "qux",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"--view">());
+    CHECK(*opts.get<"--view">() == "foo");
+    CHECK(opts.get<"--view">()->data() == args[1] + 7);
+
+    auto views = opts.get<"--views">();
+    REQUIRE(views.size() == 1);
+    CHECK(views[0].data() == args[3]);
+
+    auto rest = opts.get<"rest">();
+    REQUIRE(rest.size() == 2);
+    CHECK(rest[0].data() == args[4]);
+    CHECK(rest[1].data() == args[5]);
+    CHECK(opts.get_or<"--view">("default") == "foo");
+}
+
 TEST_CASE("Calling from main() works as expected") {
     using options = clopts<option<"--number", "A number", int64_t>>;
 
@@ -460,6 +734,1096 @@ TEST_CASE("File option can map a file properly") {
     run.template operator()<file<std::string, std::vector<char>>>();
 }
 
+TEST_CASE("File read strategies all read the same contents") {
+    auto run = []<typename contents_type, typename strategy> {
+        using options = clopts<option<"file", "A file", file<contents_type, std::filesystem::path, strategy>>>;
+        std::array args = {"test", "file", __FILE__};
+        auto contents = this_file<std::filesystem::path, contents_type>().second;
+        auto opts = options::parse(args.size(), args.data(), error_handler);
+        REQUIRE(opts.template get<"file">());
+        CHECK(opts.template get<"file">()->contents == contents);
+
+        std::array missing = {"test", "file", "/this/file/does/not/exist"};
+        CHECK_THROWS(options::parse(missing.size(), missing.data(), error_handler));
+    };
+
+    auto run_all = [&]<typename contents_type> {
+        run.template operator()<contents_type, read_strategy::stdio>();
+#if CLOPTS_USE_MMAP
+        run.template operator()<contents_type, read_strategy::pread>();
+        run.template operator()<contents_type, read_strategy::mmap<>>();
+        run.template operator()<contents_type, read_strategy::mmap<true, true, true>>();
+        run.template operator()<contents_type, read_strategy::fadvise>();
+#    ifdef O_DIRECT
+        run.template operator()<contents_type, read_strategy::direct<>>();
+#    endif
+#endif
+    };
+
+    run_all.template operator()<std::string>();
+    run_all.template operator()<std::vector<char>>();
+}
+
+TEST_CASE("aligned_buffer<> aligns and pads the contents of a file") {
+    auto contents = this_file().second;
+    auto check = []<std::size_t alignment, std::size_t padding>(const aligned_buffer<alignment, padding>& buffer, std::string_view expected) {
+        CHECK(buffer == expected);
+        CHECK(std::uintptr_t(buffer.data()) % alignment == 0);
+        REQUIRE(buffer.padded().size() == expected.size() + padding);
+        CHECK(std::ranges::all_of(buffer.padded().subspan(expected.size()), [](char c) { return c == 0; }));
+    };
+
+    auto run = [&]<typename strategy> {
+        using options = clopts<
+            option<"--file", "A file", file<aligned_buffer<>, std::filesystem::path, strategy>>,
+            option<"--page", "A file", file<aligned_buffer<4096, 17>, std::filesystem::path, strategy>>,
+            multiple<option<"--ref", "A reference", ref<std::string, "--file">>>>;
+
+        std::array args = {"test", "--file", __FILE__, "--page", __FILE__, "--ref", "x"};
+        auto opts = options::parse(args.size(), args.data(), error_handler);
+        REQUIRE(opts.template get<"--file">());
+        REQUIRE(opts.template get<"--page">());
+        check(opts.template get<"--file">()->contents, contents);
+        check(opts.template get<"--page">()->contents, contents);
+
+        // Referencing the file copies the buffer.
+        auto refs = opts.template get<"--ref">();
+        REQUIRE(refs.size() == 1);
+        check(std::get<1>(refs[0])->contents, contents);
+    };
+
+    run.template operator()<read_strategy::stdio>();
+#if CLOPTS_USE_MMAP
+    run.template operator()<read_strategy::pread>();
+    run.template operator()<read_strategy::mmap<>>();
+#endif
+
+    SECTION("Empty buffers are padded too") {
+        aligned_buffer<> empty;
+        check(empty, "");
+        empty.resize(100);
+        empty.resize(3);
+        check(empty, std::string_view{empty.data(), 3});
+        empty.clear();
+        check(empty, "");
+        CHECK(empty.capacity() == 100);
+    }
+}
+
+TEST_CASE("max_size<> and file_budget<> limit how much is read") {
+    auto path = (std::filesystem::temp_directory_path() / "clopts-test-max-size").string();
+    std::string text(1000, 'x');
+    {
+        std::FILE* f = std::fopen(path.c_str(), "wb");
+        REQUIRE(f);
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    }
+
+    std::vector<parse_error> errors;
+    std::vector<std::string> messages;
+    auto handler = [&](const parse_error& e) {
+        errors.push_back(e);
+        messages.push_back(e.message());
+        return true;
+    };
+
+    SECTION("max_size<>") {
+        using options = clopts<
+            option<"--small", "A file", file<std::string, std::string, read_strategy::max_size<999>>>,
+            option<"--exact", "A file", file<std::string, std::string, read_strategy::max_size<1000, false, read_strategy::stdio>>>,
+            option<"--head", "A file", file<std::vector<char>, std::string, read_strategy::max_size<10, true>>>>;
+
+        std::array args = {"test", "--small", path.c_str(), "--exact", path.c_str(), "--head", path.c_str()};
+        auto opts = options::parse(args.size(), args.data(), handler);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].kind == error_kind::file_error);
+        CHECK(errors[0].error_code == EFBIG);
+        CHECK(errors[0].option == "--small");
+        CHECK(opts.get<"--exact">()->contents == text);
+        CHECK(std::string_view{opts.get<"--head">()->contents.data(), opts.get<"--head">()->contents.size()} == text.substr(0, 10));
+    }
+
+    SECTION("file_budget<>") {
+        using options = clopts<
+            multiple<option<"--file", "Files", file<>>>,
+            option<"--head", "A file", file<std::string, std::string, read_strategy::max_size<100, true>>>,
+            option<"--mapped", "A file", mapped_file<>>,
+            file_budget<2100>>;
+
+        std::array args = {
+            "test",
+            "--file", path.c_str(),
+            "--mapped", path.c_str(),
+            "--head", path.c_str(),
+            "--file", path.c_str(),
+            "--file", path.c_str(),
+        };
+
+        // Mapped files don’t count, and max_size<> files only count up to their limit.
+        auto opts = options::parse(args.size(), args.data(), handler);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].kind == error_kind::file_budget_exceeded);
+        CHECK(errors[0].option == "--file");
+        CHECK(errors[0].argument_index == 10);
+        CHECK(messages[0] == "Could not read file \"" + path + "\": total size of all files exceeds the limit");
+        CHECK(opts.get<"--file">()[1].contents == text);
+
+        // The budget is per parse.
+        errors.clear();
+        options::parser parser{handler};
+        for (int i = 0; i < 2; i++) (void) parser.parse(7, args.data());
+        CHECK(errors.empty());
+    }
+
+    SECTION("file_budget<> with parallel_file_loading") {
+        using options = clopts<
+            multiple<option<"--file", "Files", file<>>>,
+            overridable<"--config", "A file", file<>>,
+            file_budget<2000>,
+            parallel_file_loading<2>>;
+
+        // Overridden files are never loaded, so they don’t count.
+        std::array args = {
+            "test",
+            "--config", path.c_str(),
+            "--file", path.c_str(),
+            "--config", path.c_str(),
+            "--file", path.c_str(),
+        };
+
+        auto opts = options::parse(args.size(), args.data(), handler);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].kind == error_kind::file_budget_exceeded);
+        CHECK(errors[0].option == "--file");
+        CHECK(errors[0].argument_index == 8);
+        CHECK(opts.get<"--file">()[0].contents == text);
+        CHECK(opts.get<"--config">()->contents == text);
+    }
+
+#ifdef __linux__
+    SECTION("Pipes") {
+        using options = clopts<
+            option<"--head", "A file", file<std::string, std::string, read_strategy::max_size<10, true>>>,
+            option<"--file", "A file", file<std::string, std::string, read_strategy::max_size<100>>>>;
+
+        int fds[2];
+        REQUIRE(::pipe(fds) == 0);
+        REQUIRE(::write(fds[1], text.data(), text.size()) == ssize_t(text.size()));
+        ::close(fds[1]);
+
+        auto pipe = "/proc/self/fd/" + std::to_string(fds[0]);
+        std::array args = {"test", "--head", pipe.c_str()};
+        auto opts = options::parse(args.size(), args.data(), handler);
+        CHECK(errors.empty());
+        CHECK(opts.get<"--head">()->contents == text.substr(0, 10));
+
+        // Read the rest of the pipe, which is too large.
+        std::array rest = {"test", "--file", pipe.c_str()};
+        (void) options::parse(rest.size(), rest.data(), handler);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].error_code == EFBIG);
+        ::close(fds[0]);
+    }
+
+    SECTION("Devices are only read up to an explicit limit") {
+        using options = clopts<
+            option<"--file", "A file", file<>>,
+            option<"--head", "A file", file<std::string, std::string, read_strategy::max_size<10, true>>>,
+            option<"--max", "A file", file<std::string, std::string, read_strategy::max_size<10>>>>;
+
+        std::array args = {"test", "--file", "/dev/zero", "--head", "/dev/zero"};
+        auto opts = options::parse(args.size(), args.data(), handler);
+        CHECK(errors.empty());
+        CHECK(opts.get<"--file">()->contents.empty());
+        CHECK(opts.get<"--head">()->contents == std::string(10, '\0'));
+
+        std::array max = {"test", "--max", "/dev/zero"};
+        (void) options::parse(max.size(), max.data(), handler);
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].error_code == EFBIG);
+    }
+#endif
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("parallel_file_loading loads files after the scan") {
+    using options = clopts<
+        multiple<option<"--input", "Input files", file<>>>,
+        overridable<"--config", "Config file", file<>>,
+        option<"--int", "An integer", int64_t>,
+        parallel_file_loading<4>>;
+
+    auto contents = this_file().second;
+    std::vector<const char*> args{"test", "--config", "/this/file/does/not/exist"};
+    for (int i = 0; i < 20; i++) {
+        args.push_back("--input");
+        args.push_back(__FILE__);
+    }
+    args.push_back("--config");
+    args.push_back(__FILE__);
+
+    auto opts = options::parse(int(args.size()), args.data(), error_handler);
+    auto inputs = opts.get<"--input">();
+    REQUIRE(inputs.size() == 20);
+    for (auto& input : inputs) {
+        CHECK(input.path == __FILE__);
+        CHECK(input.contents == contents);
+    }
+
+    // The overridden config file is never opened.
+    REQUIRE(opts.get<"--config">());
+    CHECK(opts.get<"--config">()->contents == contents);
+
+    SECTION("Errors are reported in argv order") {
+        std::array bad = {
+            "test",
+            "--input", __FILE__,
+            "--input", "/does/not/exist/1",
+            "--input", "/does/not/exist/2",
+            "--int", "1",
+        };
+
+        std::vector<parse_error> errors;
+        options::parse(bad.size(), bad.data(), [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 2);
+        CHECK(errors[0].kind == error_kind::file_error);
+        CHECK(errors[0].argument == "/does/not/exist/1");
+        CHECK(errors[0].argument_index == 4);
+        CHECK(errors[0].option == "--input");
+        CHECK(errors[1].argument == "/does/not/exist/2");
+        CHECK(errors[1].argument_index == 6);
+    }
+
+    SECTION("A parser can be reused") {
+        options::parser parser{error_handler};
+        for (int i = 0; i < 3; i++) {
+            auto& reused = parser.parse(int(args.size()), args.data());
+            REQUIRE(reused.get<"--input">().size() == 20);
+            CHECK(reused.get<"--input">()[19].contents == contents);
+        }
+    }
+
+    SECTION("Many files with different read strategies") {
+        using mixed = clopts<
+            multiple<option<"--input", "Input files", file<>>>,
+            multiple<option<"--stdio", "Input files", file<std::vector<char>, std::string, read_strategy::stdio>>>,
+            parallel_file_loading<>>;
+
+        std::vector<const char*> many{"test"};
+        for (int i = 0; i < 300; i++) {
+            many.push_back(i % 10 ? "--input" : "--stdio");
+            many.push_back(__FILE__);
+        }
+
+#if CLOPTS_USE_MMAP
+        many.push_back("--input");
+        many.push_back("/dev/null");
+#endif
+
+        auto mixed_opts = mixed::parse(int(many.size()), many.data(), error_handler);
+        auto inputs = mixed_opts.get<"--input">();
+        auto stdio = mixed_opts.get<"--stdio">();
+        REQUIRE(stdio.size() == 30);
+        for (auto& f : stdio) CHECK(std::string_view{f.contents.data(), f.contents.size()} == contents);
+        REQUIRE(inputs.size() >= 270);
+        for (auto& f : inputs.first(270)) CHECK(f.contents == contents);
+#if CLOPTS_USE_MMAP
+        REQUIRE(inputs.size() == 271);
+        CHECK(inputs[270].contents.empty());
+#endif
+    }
+
+#if CLOPTS_USE_IO_URING
+    SECTION("Files are still loaded if io_uring fails partway through") {
+        using batched = clopts<multiple<option<"--input", "Input files", file<>>>, parallel_file_loading<>>;
+        auto empty = std::filesystem::temp_directory_path() / "clopts-io-uring-empty";
+        std::ofstream{empty}.flush();
+
+        std::vector<const char*> many{"test"};
+        for (int i = 0; i < 300; i++) {
+            many.push_back("--input");
+            many.push_back(i % 7 ? __FILE__ : empty.c_str());
+        }
+
+        for (int failure = 0; failure < 16; failure++) {
+            io_uring_enter_calls_until_failure = failure;
+            auto batched_opts = batched::parse(int(many.size()), many.data(), error_handler);
+            io_uring_enter_calls_until_failure = -1;
+
+            auto inputs = batched_opts.get<"--input">();
+            REQUIRE(inputs.size() == 300);
+            for (std::size_t i = 0; i < inputs.size(); i++) CHECK(inputs[i].contents == (i % 7 ? contents : ""));
+        }
+
+        std::filesystem::remove(empty);
+    }
+#endif
+}
+
+TEST_CASE("mapped_file<> maps a file without copying it") {
+    using options = clopts<
+        option<"--file", "A file", mapped_file<>>,
+        multiple<option<"--files", "Files", mapped_file<std::string>>>>;
+
+    std::array args = {
+        "test",
+        "--file", __FILE__,
+        "--files", __FILE__,
+        "--files", __FILE__,
+    };
+
+    auto [path, contents] = this_file();
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"--file">());
+    CHECK(opts.get<"--file">()->path == path);
+    CHECK(opts.get<"--file">()->contents() == contents);
+    CHECK(opts.get<"--file">()->bytes().size() == contents.size());
+
+    // Moving the option values doesn’t move the mapping.
+    auto data = opts.get<"--file">()->contents().data();
+    auto moved = std::move(opts);
+    CHECK(moved.get<"--file">()->contents().data() == data);
+
+    auto files = moved.get<"--files">();
+    REQUIRE(files.size() == 2);
+    CHECK(files[0].path == __FILE__);
+    CHECK(files[1].contents() == contents);
+    CHECK(files[0].contents().data() != files[1].contents().data());
+
+    std::array missing = {"test", "--file", "/this/file/does/not/exist"};
+    CHECK_THROWS(options::parse(missing.size(), missing.data(), error_handler));
+
+    SECTION("Referencing a mapped file shares the mapping") {
+        using ref_options = clopts<
+            option<"--file", "A file", mapped_file<>>,
+            option<"--ref", "A reference", ref<std::string, "--file">>>;
+
+        std::array ref_args = {"test", "--file", __FILE__, "--ref", "x"};
+        auto ref_opts = ref_options::parse(ref_args.size(), ref_args.data(), error_handler);
+        auto& [value, file] = *ref_opts.get<"--ref">();
+        CHECK(value == "x");
+        REQUIRE(file);
+        CHECK(file->contents().data() == ref_opts.get<"--file">()->contents().data());
+    }
+}
+
+/// A read strategy that counts how many files it has read.
+struct counting_strategy {
+    static inline int reads = 0;
+
+    template <typename contents_type>
+    static int read(std::string_view path, contents_type& contents) {
+        reads++;
+        return read_strategy::stdio::read(path, contents);
+    }
+};
+
+#if CLOPTS_USE_MMAP
+TEST_CASE("dedupe_files only loads each file once") {
+    using options = clopts<
+        multiple<option<"--file", "Files", file<std::string, std::string, counting_strategy>>>,
+        multiple<option<"--other", "Files", file<std::string, std::string, counting_strategy>>>,
+        multiple<option<"--mapped", "Files", mapped_file<>>>,
+        multiple<option<"--lines", "Files", lines<>>>,
+        dedupe_files>;
+
+    auto dir = std::filesystem::temp_directory_path() / "clopts-test-dedupe";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto original = (dir / "original").string();
+    auto symlink = (dir / "symlink").string();
+    auto hardlink = (dir / "hardlink").string();
+    std::filesystem::copy_file(__FILE__, original);
+    std::filesystem::create_symlink(original, symlink);
+    std::filesystem::create_hard_link(original, hardlink);
+
+    std::array args = {
+        "test",
+        "--file", original.c_str(),
+        "--file", symlink.c_str(),
+        "--file", hardlink.c_str(),
+        "--file", __FILE__,
+        "--other", original.c_str(),
+        "--mapped", original.c_str(),
+        "--mapped", symlink.c_str(),
+        "--lines", hardlink.c_str(),
+    };
+
+    auto contents = this_file().second;
+    counting_strategy::reads = 0;
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+
+    // file<> options are read once per file, and every copy keeps its own path.
+    CHECK(counting_strategy::reads == 2);
+    auto files = opts.get<"--file">();
+    REQUIRE(files.size() == 4);
+    CHECK(files[1].path == symlink);
+    CHECK(files[2].path == hardlink);
+    for (auto& f : files) CHECK(f.contents == contents);
+    CHECK(opts.get<"--other">()[0].contents == contents);
+
+    // Mappings are shared between all options.
+    auto mapped = opts.get<"--mapped">();
+    REQUIRE(mapped.size() == 2);
+    CHECK(mapped[0].contents() == contents);
+    CHECK(mapped[0].contents().data() == mapped[1].contents().data());
+    CHECK(opts.get<"--lines">()[0].contents().data() == mapped[0].contents().data());
+
+    // Modifying a file makes it a different file.
+    counting_strategy::reads = 0;
+    std::array modified_args = {"test", "--file", original.c_str(), "--file", original.c_str()};
+    auto first = std::filesystem::last_write_time(original);
+    {
+        options::parser parser{error_handler};
+        (void) parser.parse(int(modified_args.size()), modified_args.data());
+        CHECK(counting_strategy::reads == 1);
+        std::filesystem::last_write_time(original, first + std::chrono::seconds(1));
+        (void) parser.parse(int(modified_args.size()), modified_args.data());
+        CHECK(counting_strategy::reads == 2);
+    }
+
+    SECTION("Options share a single buffer per file") {
+        using shared = clopts<
+            option<"--a", "A file", file<shared_buffer, std::string, counting_strategy>>,
+            multiple<option<"--b", "Files", file<shared_buffer, std::string, counting_strategy>>>,
+            multiple<option<"--copy", "Files", file<std::string, std::string, counting_strategy>>>,
+            dedupe_files>;
+
+        counting_strategy::reads = 0;
+        std::array shared_args = {
+            "test",
+            "--a", original.c_str(),
+            "--b", symlink.c_str(),
+            "--b", hardlink.c_str(),
+            "--copy", original.c_str(),
+        };
+
+        auto shared_opts = shared::parse(shared_args.size(), shared_args.data(), error_handler);
+        CHECK(counting_strategy::reads == 2);
+        REQUIRE(shared_opts.get<"--a">());
+        auto& a = shared_opts.get<"--a">()->contents;
+        auto b = shared_opts.get<"--b">();
+        REQUIRE(b.size() == 2);
+        CHECK(a == contents);
+        CHECK(b[0].contents.view().data() == a.view().data());
+        CHECK(b[1].contents.view().data() == a.view().data());
+        CHECK(shared_opts.get<"--copy">()[0].contents == contents);
+    }
+
+    SECTION("Files referenced by ref<> are deduplicated too") {
+        using referencing = clopts<
+            overridable<"--n", "A number", std::int64_t>,
+            multiple<option<"--file", "Files", ref<file<std::string, std::string, counting_strategy>, "--n">>>,
+            dedupe_files>;
+
+        counting_strategy::reads = 0;
+        std::array ref_args = {"test", "--n", "1", "--file", original.c_str(), "--n", "2", "--file", symlink.c_str()};
+        auto ref_opts = referencing::parse(ref_args.size(), ref_args.data(), error_handler);
+        CHECK(counting_strategy::reads == 1);
+        auto files = ref_opts.get<"--file">();
+        REQUIRE(files.size() == 2);
+        CHECK(std::get<0>(files[0]).contents == contents);
+        CHECK(std::get<0>(files[1]).path == symlink);
+        CHECK(std::get<0>(files[1]).contents == contents);
+        CHECK(std::get<1>(files[1]) == 2);
+        CHECK(std::get<1>(files[0]) == 1);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+#endif
+
+TEST_CASE("lazy_file<> is only read when its contents are accessed") {
+    using options = clopts<
+        option<"--file", "A file", lazy_file<>>,
+        multiple<option<"--files", "Files", lazy_file<std::vector<char>, std::string>>>>;
+
+    auto path = std::filesystem::temp_directory_path() / "clopts-test-lazy-file";
+    auto write = [&](std::string_view text) {
+        std::FILE* f = std::fopen(path.string().c_str(), "wb");
+        REQUIRE(f);
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    };
+
+    write("before");
+    auto path_str = path.string();
+    std::array args = {"test", "--file", path_str.c_str(), "--files", __FILE__};
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+
+    // The file is read on first access, not during parsing.
+    write("after");
+    REQUIRE(opts.get<"--file">());
+    CHECK(opts.get<"--file">()->path == path);
+    CHECK(opts.get<"--file">()->contents() == "after");
+    CHECK(opts.get<"--file">()->error() == 0);
+
+    // And it is only read once.
+    write("again");
+    CHECK(opts.get<"--file">()->contents() == "after");
+
+    // Concurrent first accesses all see the same contents.
+    auto files = opts.get<"--files">();
+    REQUIRE(files.size() == 1);
+    std::array<const std::vector<char>*, 4> seen{};
+    {
+        std::vector<std::jthread> threads;
+        for (auto& s : seen) threads.emplace_back([&] { s = &files[0].contents(); });
+    }
+    for (auto* s : seen) CHECK(s == &files[0].contents());
+    CHECK(std::string_view{files[0].contents().data(), files[0].contents().size()} == this_file().second);
+
+    // Files that don’t exist are still an error during parsing.
+    std::filesystem::remove(path);
+    CHECK_THROWS(options::parse(args.size(), args.data(), error_handler));
+
+    // So are directories.
+    auto dir = std::filesystem::temp_directory_path().string();
+    std::array dir_args = {"test", "--file", dir.c_str()};
+    CHECK_THROWS(options::parse(dir_args.size(), dir_args.data(), error_handler));
+}
+
+TEST_CASE("watched_file<> reloads a file when it changes") {
+    using options = clopts<
+        option<"--file", "A file", watched_file<>>,
+        option<"--other", "A file", watched_file<std::vector<char>, std::string>>>;
+
+    auto dir = std::filesystem::temp_directory_path() / "clopts-test-watched-file";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto path = (dir / "config").string();
+    auto other = (dir / "other").string();
+    auto write = [&](const std::string& p, std::string_view text) {
+        std::FILE* f = std::fopen(p.c_str(), "wb");
+        REQUIRE(f);
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+    };
+
+    write(path, "first");
+    write(other, "other");
+    std::array args = {"test", "--file", path.c_str(), "--other", other.c_str()};
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    auto& file = *opts.get<"--file">();
+    CHECK(file.path == path);
+    CHECK(*file.contents() == "first");
+    CHECK(file.version() == 1);
+
+#if CLOPTS_USE_INOTIFY
+    std::atomic<int> calls = 0;
+    file.on_change([&](const std::string& contents) {
+        CHECK(not contents.empty());
+        calls++;
+    });
+
+    // Wait until the file has been reloaded.
+    auto wait_for = [&](std::uint64_t version) {
+        for (int i = 0; i < 500 and file.version() < version; i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return file.version() == version;
+    };
+
+    // Readers that hold on to the old contents keep them.
+    auto old = file.contents();
+    write(path, "second");
+    REQUIRE(wait_for(2));
+    CHECK(*file.contents() == "second");
+    CHECK(*old == "first");
+    CHECK(calls == 1);
+
+    // Files that are replaced by renaming another file are reloaded too.
+    auto replace = [&](std::string_view text) {
+        write(path + ".tmp", text);
+        std::filesystem::rename(path + ".tmp", path);
+    };
+
+    replace("third");
+    REQUIRE(wait_for(3));
+    CHECK(*file.contents() == "third");
+
+    // Writing the same contents again or changing other files in the same directory
+    // does nothing; replace the file afterwards to make sure those were processed.
+    write(path, "third");
+    write(other, "changed");
+    replace("fourth");
+    REQUIRE(wait_for(4));
+    CHECK(*file.contents() == "fourth");
+    CHECK(calls == 3);
+
+    // Copies share the contents.
+    auto copy = file;
+    CHECK(copy.contents() == file.contents());
+
+    // If the file can’t be read anymore, the old contents are kept.
+    std::filesystem::remove(path);
+    std::filesystem::create_directory(dir / "subdir");
+    std::filesystem::rename(dir / "subdir", path);
+    for (int i = 0; i < 500 and file.error() == 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(file.error() != 0);
+    CHECK(file.version() == 4);
+    CHECK(*file.contents() == "fourth");
+#endif
+
+    // Files that don’t exist are an error during parsing.
+    std::filesystem::remove_all(dir);
+    CHECK_THROWS(options::parse(args.size(), args.data(), error_handler));
+}
+
+TEST_CASE("stream<> reads a file in chunks") {
+    using options = clopts<
+        option<"--stream", "A stream", stream<4096>>,
+        option<"--file", "A file", file<>>>;
+
+    auto read_all = [](auto& s) {
+        std::string text;
+        for (auto chunk = s.next(); not chunk.empty(); chunk = s.next()) {
+            CHECK(chunk.size() <= 4096);
+            text += chunk;
+        }
+
+        CHECK(s.eof());
+        CHECK(s.error() == 0);
+        return text;
+    };
+
+    auto contents = this_file().second;
+    std::array args = {"test", "--stream", __FILE__};
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"--stream">());
+    CHECK(opts.get<"--stream">()->path == __FILE__);
+    CHECK(read_all(*opts.get<"--stream">()) == contents);
+    CHECK(opts.get<"--stream">()->next().empty());
+
+    std::array missing = {"test", "--stream", "/this/file/does/not/exist"};
+    CHECK_THROWS(options::parse(missing.size(), missing.data(), error_handler));
+
+#if CLOPTS_USE_MMAP
+    auto dir = std::filesystem::temp_directory_path().string();
+    std::array dir_args = {"test", "--stream", dir.c_str()};
+    CHECK_THROWS(options::parse(dir_args.size(), dir_args.data(), error_handler));
+
+    // Write the contents of this file to a pipe on another thread.
+    auto with_pipe = [&](auto callback) {
+        std::array<int, 2> fds{};
+        REQUIRE(::pipe(fds.data()) == 0);
+        std::jthread writer{[&] {
+            for (std::string_view rest = contents; not rest.empty();) {
+                auto n = ::write(fds[1], rest.data(), rest.size());
+                if (n < 0) break;
+                rest.remove_prefix(std::size_t(n));
+            }
+            ::close(fds[1]);
+        }};
+
+        callback(fds[0]);
+        ::close(fds[0]);
+    };
+
+    SECTION("Pipes") {
+        with_pipe([&](int fd) {
+            auto path = "/proc/self/fd/" + std::to_string(fd);
+            std::array pipe_args = {"test", "--stream", path.c_str()};
+            auto pipe_opts = options::parse(pipe_args.size(), pipe_args.data(), error_handler);
+            CHECK(read_all(*pipe_opts.get<"--stream">()) == contents);
+        });
+    }
+
+    SECTION("file<> reads pipes to the end") {
+        with_pipe([&](int fd) {
+            auto path = "/proc/self/fd/" + std::to_string(fd);
+            std::array pipe_args = {"test", "--file", path.c_str()};
+            auto pipe_opts = options::parse(pipe_args.size(), pipe_args.data(), error_handler);
+            CHECK(pipe_opts.get<"--file">()->contents == contents);
+        });
+    }
+
+    SECTION("'-' is stdin") {
+        with_pipe([&](int fd) {
+            int saved = ::dup(STDIN_FILENO);
+            ::dup2(fd, STDIN_FILENO);
+            std::array stdin_args = {"test", "--stream", "-"};
+            {
+                auto stdin_opts = options::parse(stdin_args.size(), stdin_args.data(), error_handler);
+                CHECK(read_all(*stdin_opts.get<"--stream">()) == contents);
+            }
+
+            // stdin isn’t closed.
+            CHECK(::fcntl(STDIN_FILENO, F_GETFD) != -1);
+            ::dup2(saved, STDIN_FILENO);
+            ::close(saved);
+        });
+    }
+#endif
+}
+
+TEST_CASE("output_file<> creates a file during parsing") {
+    using options = clopts<
+        option<"--out", "An output file", output_file<>>,
+        option<"--small", "An output file", output_file<1 << 20, 16, std::string>>>;
+
+    auto dir = std::filesystem::temp_directory_path() / "clopts-test-output-file";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto out = (dir / "out").string();
+    auto small = (dir / "small").string();
+    auto read = [](const std::string& path) {
+        std::ifstream f{path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{f}, {}};
+    };
+
+    // Existing files are truncated.
+    {
+        std::ofstream f{out};
+        f << "old contents";
+    }
+
+    std::array args = {"test", "--out", out.c_str(), "--small", small.c_str()};
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    CHECK(std::filesystem::exists(small));
+    CHECK(std::filesystem::file_size(out) == 0);
+
+    SECTION("Writing") {
+        // Preallocating space doesn’t change the file size.
+        CHECK(std::filesystem::file_size(small) == 0);
+
+        // Write pieces that are smaller than, as large as, and larger than the buffer.
+        std::string expected;
+        auto& f = *opts.get<"--small">();
+        for (auto piece : {"abc"sv, "0123456789abcdef"sv, "x"sv, "a longer piece of text that doesn’t fit"sv}) {
+            f.write(piece);
+            expected += piece;
+        }
+
+        f.write(std::as_bytes(std::span{"bytes", 5}));
+        expected += "bytes";
+        CHECK(f.close() == 0);
+        CHECK(read(small) == expected);
+
+        // Closing a file twice is fine.
+        CHECK(f.close() == 0);
+    }
+
+    SECTION("Mapping") {
+        auto& f = *opts.get<"--out">();
+        auto mapping = f.map(5000);
+        REQUIRE(mapping.size() == 5000);
+        std::ranges::fill(mapping, std::byte{'x'});
+        CHECK(f.close() == 0);
+        CHECK(read(out) == std::string(5000, 'x'));
+    }
+
+    SECTION("The value is closed when it is destroyed") {
+        opts.get<"--out">()->write("text");
+        CHECK(read(out).empty());
+        opts = options::parse(1, args.data(), error_handler);
+        CHECK(read(out) == "text");
+    }
+
+    SECTION("Errors") {
+        std::vector<parse_error> errors;
+        auto missing = (dir / "does/not/exist").string();
+        auto d = dir.string();
+        std::array bad = {"test", "--out", missing.c_str(), "--small", d.c_str()};
+        options::parse(bad.size(), bad.data(), [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 2);
+        CHECK(errors[0].kind == error_kind::output_file_error);
+        CHECK(errors[0].error_code == ENOENT);
+        CHECK(errors[0].message() == "Could not open file \"" + missing + "\" for writing: " + std::strerror(ENOENT));
+        CHECK(errors[1].error_code == EISDIR);
+    }
+
+    SECTION("Existing files survive a failed parse") {
+        using with_number = clopts<
+            option<"--out", "An output file", output_file<>>,
+            option<"--number", "A number", int64_t>>;
+
+        {
+            std::ofstream f{out};
+            f << "old contents";
+        }
+
+        std::array bad = {"test", "--out", out.c_str(), "--number", "not a number"};
+        CHECK_THROWS(with_number::parse(bad.size(), bad.data(), error_handler));
+        CHECK(read(out) == "old contents");
+
+        std::array unknown = {"test", "--out", out.c_str(), "--unknown"};
+        CHECK_THROWS(with_number::parse(unknown.size(), unknown.data(), error_handler));
+        CHECK(read(out) == "old contents");
+
+        // If the error handler lets us continue, the file is truncated when we first write to it.
+        auto ignore_errors = [](const parse_error&) { return true; };
+        auto tolerated = with_number::parse(bad.size(), bad.data(), ignore_errors);
+        CHECK(read(out) == "old contents");
+        REQUIRE(tolerated.get<"--out">());
+        tolerated.get<"--out">()->write("new");
+        CHECK(tolerated.get<"--out">()->close() == 0);
+        CHECK(read(out) == "new");
+    }
+
+    opts = {};
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("lines<> splits a file into lines") {
+    using options = clopts<option<"--lines", "A list", lines<>>>;
+    auto path = std::filesystem::temp_directory_path() / "clopts-test-lines";
+    auto path_str = path.string();
+    std::array args = {"test", "--lines", path_str.c_str()};
+    auto parse = [&](std::string_view text) {
+        std::FILE* f = std::fopen(path_str.c_str(), "wb");
+        REQUIRE(f);
+        std::fwrite(text.data(), 1, text.size(), f);
+        std::fclose(f);
+        auto opts = options::parse(args.size(), args.data(), error_handler);
+        REQUIRE(opts.get<"--lines">());
+        return std::vector<std::string>(opts.get<"--lines">()->begin(), opts.get<"--lines">()->end());
+    };
+
+    using v = std::vector<std::string>;
+    CHECK(parse("") == v{});
+    CHECK(parse("\n") == v{""});
+    CHECK(parse("a") == v{"a"});
+    CHECK(parse("a\nb\n") == v{"a", "b"});
+    CHECK(parse("a\r\n\r\nb\r\nc") == v{"a", "", "b", "c"});
+
+    // Lines that cross the blocks we compare at once.
+    std::string text;
+    v expected;
+    for (std::size_t i = 0; i < 200; i++) {
+        expected.push_back(std::string(i, char('a' + i % 26)));
+        text += expected.back() + "\n";
+    }
+    CHECK(parse(text) == expected);
+
+    // Same as splitting this file with std::getline().
+    std::array this_args = {"test", "--lines", __FILE__};
+    auto opts = options::parse(this_args.size(), this_args.data(), error_handler);
+    std::ifstream f{__FILE__};
+    std::size_t i = 0;
+    for (std::string line; std::getline(f, line); i++) {
+        REQUIRE(i < opts.get<"--lines">()->size());
+        CHECK((*opts.get<"--lines">())[i] == line);
+    }
+    CHECK(i == opts.get<"--lines">()->size());
+    CHECK(opts.get<"--lines">()->contents() == this_file().second);
+
+    std::filesystem::remove(path);
+    CHECK_THROWS(options::parse(args.size(), args.data(), error_handler));
+}
+
+TEST_CASE("pmr::clopts allocates option values using a memory resource") {
+    using options = pmr::clopts<
+        option<"--string", "A string">,
+        multiple<option<"--strings", "Strings">>,
+        option<"--values", "A values option", values<"a-rather-long-value-that-is-not-small", "b">>,
+        option<"--file", "A file", file<>>,
+        multiple<option<"--ref", "A reference", ref<std::string, "--string", "--strings", "--file">>>>;
+
+    static constexpr auto long_string = "a string that is long enough that it is not stored inline";
+    std::array args = {
+        "test",
+        "--strings", long_string,
+        "--string", long_string,
+        "--values", "a-rather-long-value-that-is-not-small",
+        "--file", __FILE__,
+        "--ref", long_string,
+        "--strings", long_string,
+    };
+
+    // Make sure nothing is allocated using the default resource.
+    std::pmr::monotonic_buffer_resource arena;
+    auto old = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+    auto opts = options::parse(args.size(), args.data(), &arena, error_handler);
+    std::pmr::set_default_resource(old);
+
+    REQUIRE(opts.get<"--string">());
+    REQUIRE(opts.get<"--values">());
+    REQUIRE(opts.get<"--file">());
+    CHECK(*opts.get<"--string">() == long_string);
+    CHECK(opts.get<"--string">()->get_allocator().resource() == &arena);
+    CHECK(opts.get<"--values">()->get_allocator().resource() == &arena);
+    CHECK(opts.get<"--file">()->contents.get_allocator().resource() == &arena);
+    CHECK(std::string_view{opts.get<"--file">()->contents} == this_file().second);
+
+    auto strings = opts.get<"--strings">();
+    REQUIRE(strings.size() == 2);
+    CHECK(strings[0].get_allocator().resource() == &arena);
+    CHECK(strings[1].get_allocator().resource() == &arena);
+
+    auto refs = opts.get<"--ref">();
+    REQUIRE(refs.size() == 1);
+    auto& [value, string, strings_ref, file_ref] = refs[0];
+    REQUIRE(string.has_value());
+    REQUIRE(file_ref.has_value());
+    CHECK(value.get_allocator().resource() == &arena);
+    CHECK(string->get_allocator().resource() == &arena);
+    CHECK(strings_ref.get_allocator().resource() == &arena);
+    CHECK(strings_ref.size() == 1);
+    CHECK(strings_ref[0].get_allocator().resource() == &arena);
+    CHECK(file_ref->contents.get_allocator().resource() == &arena);
+}
+
+TEST_CASE("A parser can be reused") {
+    using options = clopts<
+        option<"--string", "A string">,
+        option<"--number", "A number", int64_t>,
+        flag<"--flag", "A flag">,
+        multiple<option<"--int", "Integers", int64_t>>,
+        multiple<positional<"rest", "The remaining arguments", std::string_view, false>>>;
+
+    static constexpr auto long_string = "a string that is long enough that it is not stored inline";
+    std::array args1 = {
+        "test",
+        "--string", long_string,
+        "--number", "1",
+        "--flag",
+        "--int", "1",
+        "--int", "2",
+        "foo",
+        "bar",
+    };
+
+    std::array args2 = {
+        "test",
+        "--string", "short",
+        "--int", "3",
+        "baz",
+    };
+
+    options::parser parser{error_handler};
+    auto& opts1 = parser.parse(args1.size(), args1.data());
+    REQUIRE(opts1.get<"--string">());
+    CHECK(*opts1.get<"--string">() == long_string);
+    CHECK(opts1.get<"--flag">());
+    CHECK(opts1.get<"--int">().size() == 2);
+    CHECK(opts1.get<"rest">().size() == 2);
+
+    auto string_data = opts1.get<"--string">()->data();
+    auto ints_data = opts1.get<"--int">().data();
+    auto& opts2 = parser.parse(args2.size(), args2.data());
+    CHECK(&opts1 == &opts2);
+
+    REQUIRE(opts2.get<"--string">());
+    CHECK(*opts2.get<"--string">() == "short");
+    CHECK(opts2.get<"--string">()->data() == string_data);
+    CHECK(not opts2.get<"--number">());
+    CHECK(not opts2.get<"--flag">());
+
+    auto ints = opts2.get<"--int">();
+    REQUIRE(ints.size() == 1);
+    CHECK(ints[0] == 3);
+    CHECK(ints.data() == ints_data);
+
+    auto rest = opts2.get<"rest">();
+    REQUIRE(rest.size() == 1);
+    CHECK(rest[0] == "baz");
+
+    parser.reset();
+    CHECK(not opts2.get<"--string">());
+    CHECK(opts2.get<"--int">().empty());
+}
+
+TEST_CASE("Reusing a parser doesn’t allocate once it has warmed up") {
+    struct counting_resource : std::pmr::memory_resource {
+        std::size_t allocations = 0;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            allocations++;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    using options = pmr::clopts<
+        option<"--string", "A string">,
+        multiple<option<"--strings", "Strings">>,
+        option<"--file", "A file", file<>>,
+        multiple<option<"--files", "Files", file<>>>,
+        multiple<option<"--int", "Integers", int64_t>>>;
+
+    auto small = (std::filesystem::temp_directory_path() / "clopts-test-reuse").string();
+    std::ofstream{small} << "small";
+
+    static constexpr auto long_string = "a string that is long enough that it is not stored inline";
+    static constexpr auto longer_string = "a string that is even longer than the other one, so it needs more memory";
+    std::array args = {
+        "test",
+        "--strings", long_string,
+        "--file", __FILE__,
+        "--files", small.c_str(),
+        "--files", __FILE__,
+        "--strings", longer_string,
+        "--string", long_string,
+        "--int", "1",
+        "--int", "2",
+    };
+
+    auto contents = this_file().second;
+    auto check = [&](auto& opts) {
+        REQUIRE(opts.template get<"--string">());
+        CHECK(*opts.template get<"--string">() == long_string);
+        REQUIRE(opts.template get<"--strings">().size() == 2);
+        CHECK(opts.template get<"--strings">()[0] == long_string);
+        CHECK(opts.template get<"--strings">()[1] == longer_string);
+        REQUIRE(opts.template get<"--file">());
+        CHECK(std::string_view{opts.template get<"--file">()->contents} == contents);
+        auto files = opts.template get<"--files">();
+        REQUIRE(files.size() == 2);
+        CHECK(files[0].path == small);
+        CHECK(files[0].contents == "small");
+        CHECK(std::string_view{files[1].contents} == contents);
+        CHECK(opts.template get<"--int">().size() == 2);
+    };
+
+    counting_resource resource;
+    options::parser parser{&resource, error_handler};
+
+    SECTION("argv") {
+        check(parser.parse(args.size(), args.data()));
+        auto warm = resource.allocations;
+        CHECK(warm != 0);
+        for (int i = 0; i < 3; i++) {
+            check(parser.parse(args.size(), args.data()));
+            CHECK(resource.allocations == warm);
+        }
+    }
+
+    SECTION("Range of string_views") {
+        // The paths aren’t NUL-terminated, so they are copied.
+        std::string buffer;
+        for (auto arg : args) buffer += arg;
+        std::vector<std::string_view> range;
+        std::size_t offset = 0;
+        for (auto arg : args) {
+            range.emplace_back(buffer.data() + offset, std::strlen(arg));
+            offset += range.back().size();
+        }
+
+        check(parser.parse(range));
+        auto warm = resource.allocations;
+        for (int i = 0; i < 3; i++) {
+            check(parser.parse(range));
+            CHECK(resource.allocations == warm);
+        }
+    }
+
+    std::filesystem::remove(small);
+}
+
 TEST_CASE("stop_parsing<> option") {
     using options = clopts<
         multiple<option<"--foo", "Foo option", std::string, true>>,
@@ -577,6 +1941,318 @@ TEST_CASE("stop_parsing<> option") {
     }
 }
 
+TEST_CASE("Arguments are split like a shell would") {
+    auto split = [](std::string text) {
+        std::vector<std::string> args;
+        detail::argument_tokenizer tokens{std::span{text.data(), text.size()}};
+        for (std::string_view arg; tokens.next(arg);) {
+            CHECK(arg.data()[arg.size()] == 0);
+            args.emplace_back(arg);
+        }
+        return args;
+    };
+
+    using v = std::vector<std::string>;
+    CHECK(split("") == v{});
+    CHECK(split(" \n\t\r ") == v{});
+    CHECK(split("a") == v{"a"});
+    CHECK(split("  a  b\nc\r\nd ") == v{"a", "b", "c", "d"});
+    CHECK(split(R"("a b" 'c d' e\ f)") == v{"a b", "c d", "e f"});
+    CHECK(split(R"(x"a b"y'c'z)") == v{"xa bycz"});
+    CHECK(split(R"("" '')") == v{"", ""});
+    CHECK(split(R"("a\"b\\c\d" 'a\b' \'\")") == v{R"(a"b\c\d)", R"(a\b)", R"('")"});
+    CHECK(split(R"("unterminated)") == v{"unterminated"});
+    CHECK(split(R"(trailing\)") == v{"trailing"});
+
+    // Long arguments are scanned in blocks.
+    std::string long_arg(100, 'a');
+    CHECK(split(long_arg + " " + long_arg) == v{long_arg, long_arg});
+    for (std::size_t i = 0; i < 70; i++) {
+        auto quoted = long_arg;
+        quoted.insert(i, "\"q q\"");
+        auto expected = long_arg;
+        expected.insert(i, "q q");
+        CHECK(split(quoted + "\n" + quoted) == v{expected, expected});
+    }
+}
+
+TEST_CASE("response_files<> expands @file arguments") {
+    using options = clopts<
+        option<"--int", "An integer", int64_t>,
+        option<"--file", "A file", file<>>,
+        flag<"--flag", "A flag">,
+        multiple<positional<"args", "Arguments", std::string_view, false>>,
+        stop_parsing<>,
+        response_files<3>>;
+
+    auto dir = std::filesystem::temp_directory_path() / "clopts-test-response-files";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    auto write = [&](std::string_view name, std::string_view text) {
+        auto path = (dir / name).string();
+        std::ofstream f{path, std::ios::binary};
+        f << text;
+        return path;
+    };
+
+    auto nested = write("nested", "--flag 'nested arg'");
+    auto main = write("main", "--int 42\n\"a b\" c\\ d --file " __FILE__ " @" + nested + " e");
+    auto at_main = "@" + main;
+
+    std::array args = {"test", "x", at_main.c_str(), "y"};
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    CHECK(*opts.get<"--int">() == 42);
+    CHECK(opts.get<"--flag">());
+    CHECK(opts.get<"--file">()->contents == this_file().second);
+    CHECK(std::ranges::equal(opts.get<"args">(), std::array{"x"sv, "a b"sv, "c d"sv, "nested arg"sv, "e"sv, "y"sv}));
+
+    // The response file itself is not modified.
+    {
+        std::ifstream f{main, std::ios::binary};
+        CHECK(std::string{std::istreambuf_iterator<char>{f}, {}}.starts_with("--int 42\n\"a b\""));
+    }
+
+    SECTION("Files that end on a page boundary") {
+        std::string text(4096, 'x');
+        text[0] = '\'';
+        text[10] = '\'';
+        auto at_page = "@" + write("page", text);
+        std::array page_args = {"test", at_page.c_str(), "--flag"};
+        auto page_opts = options::parse(page_args.size(), page_args.data(), error_handler);
+        CHECK(page_opts.get<"--flag">());
+        REQUIRE(page_opts.get<"args">().size() == 1);
+        CHECK(page_opts.get<"args">()[0] == std::string(9, 'x') + std::string(4085, 'x'));
+    }
+
+    SECTION("Option values can come from the next argument") {
+        auto at_value = "@" + write("value", "--int");
+        std::array value_args = {"test", at_value.c_str(), "17"};
+        CHECK(*options::parse(value_args.size(), value_args.data(), error_handler).get<"--int">() == 17);
+    }
+
+    SECTION("stop_parsing<> in a response file") {
+        auto at_stop = "@" + write("stop", "x -- --flag @nested");
+        std::array stop_args = {"test", at_stop.c_str(), "--int"};
+        auto stop_opts = options::parse(stop_args.size(), stop_args.data(), error_handler);
+        CHECK(not stop_opts.get<"--flag">());
+        auto unprocessed = stop_opts.unprocessed();
+        REQUIRE(unprocessed.size() == 3);
+        CHECK(unprocessed[0] == "--flag"sv);
+        CHECK(unprocessed[1] == "@nested"sv);
+        CHECK(unprocessed[2] == "--int"sv);
+    }
+
+    SECTION("Errors") {
+        std::vector<parse_error> errors;
+        std::vector<std::string> messages;
+        auto handler = [&](const parse_error& e) {
+            errors.push_back(e);
+            messages.push_back(e.message());
+            return true;
+        };
+
+        auto self = write("self", "--flag @" + (dir / "self").string());
+        auto deep = write("deep1", "@" + write("deep2", "@" + write("deep3", "@" + nested)));
+        auto missing = (dir / "missing").string();
+        auto at_self = "@" + self;
+        auto at_deep = "@" + deep;
+        auto at_missing = "@" + missing;
+        std::array bad = {"test", at_self.c_str(), at_deep.c_str(), at_missing.c_str(), "--int", "@"};
+        auto bad_opts = options::parse(bad.size(), bad.data(), handler);
+
+        REQUIRE(errors.size() == 4);
+        CHECK(errors[0].kind == error_kind::recursive_response_file);
+        CHECK(errors[0].argument == self);
+        CHECK(errors[0].argument_index == 1);
+        CHECK(messages[0] == "Response file \"" + self + "\" includes itself or is nested too deeply");
+        CHECK(errors[1].kind == error_kind::recursive_response_file);
+        CHECK(errors[1].argument == nested);
+        CHECK(errors[1].argument_index == 2);
+        CHECK(errors[2].kind == error_kind::file_error);
+        CHECK(errors[2].argument == missing);
+        CHECK(errors[2].error_code == ENOENT);
+
+        // A lone '@' is just an argument.
+        CHECK(errors[3].kind == error_kind::invalid_number);
+        CHECK(bad_opts.get<"--flag">());
+    }
+
+    SECTION("A parser can be reused") {
+        options::parser parser{error_handler};
+        for (int i = 0; i < 3; i++) {
+            auto& reused = parser.parse(int(args.size()), args.data());
+            CHECK(reused.get<"args">().size() == 6);
+        }
+    }
+
+    SECTION("Files from a response file are loaded and reported in order") {
+        using parallel = clopts<multiple<option<"--input", "Input files", file<>>>, parallel_file_loading<>, response_files<>>;
+
+        std::string text;
+        for (int i = 0; i < 40; i++) text += "--input " + (dir / ("missing-" + std::to_string(i))).string() + " --input " __FILE__ " ";
+        auto at_inputs = "@" + write("inputs", text);
+
+        std::vector<parse_error> errors;
+        std::array inputs_args = {"test", at_inputs.c_str()};
+        auto inputs_opts = parallel::parse(inputs_args.size(), inputs_args.data(), [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 40);
+        for (std::size_t i = 0; i < errors.size(); i++) {
+            CHECK(errors[i].argument == (dir / ("missing-" + std::to_string(i))).string());
+            CHECK(errors[i].argument_index == 1);
+        }
+
+        auto inputs = inputs_opts.get<"--input">();
+        REQUIRE(inputs.size() == 80);
+        for (std::size_t i = 0; i < inputs.size(); i += 2) CHECK(inputs[i].path == (dir / ("missing-" + std::to_string(i / 2))).string());
+        CHECK(inputs[1].contents == this_file().second);
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Options can be parsed from a range of string_views") {
+    using options = clopts<
+        option<"--int", "An integer", int64_t>,
+        option<"--double", "A double", double>,
+        option<"--file", "A file", file<>>,
+        multiple<positional<"args", "Arguments", std::string_view, false>>,
+        stop_parsing<>,
+        response_files<>>;
+
+    // None of the arguments are NUL-terminated.
+    auto path = std::string{__FILE__};
+    auto buffer = "test--int42--double1.5--file" + path + "xy--zw";
+    std::string_view b{buffer};
+    auto f = b.find(path);
+    std::vector args{b.substr(0, 4), b.substr(4, 5), b.substr(9, 2), b.substr(11, 8), b.substr(19, 3), b.substr(22, 6), b.substr(f, path.size()), b.substr(f + path.size(), 1)};
+
+    auto opts = options::parse(args, error_handler);
+    CHECK(*opts.get<"--int">() == 42);
+    CHECK(*opts.get<"--double">() == 1.5);
+    CHECK(opts.get<"--file">()->path == path);
+    CHECK(opts.get<"--file">()->contents == this_file().second);
+    REQUIRE(opts.get<"args">().size() == 1);
+    CHECK(opts.get<"args">()[0] == "x");
+    CHECK(opts.get<"args">()[0].data() == buffer.data() + f + path.size());
+
+    SECTION("Arguments after stop_parsing<> are copied") {
+        args.push_back(b.substr(b.size() - 4, 2));
+        args.push_back(b.substr(b.size() - 2, 1));
+        args.push_back(b.substr(b.size() - 1, 1));
+        auto stopped = options::parse(args, error_handler);
+        auto unprocessed = stopped.unprocessed();
+        REQUIRE(unprocessed.size() == 2);
+        CHECK(unprocessed[0] == "z"sv);
+        CHECK(unprocessed[1] == "w"sv);
+
+        // Copies of the option values share the copied arguments.
+        auto copy = stopped;
+        stopped = {};
+        CHECK(copy.unprocessed()[1] == "w"sv);
+    }
+
+    SECTION("Errors refer to the index in the range") {
+        std::vector<parse_error> errors;
+        std::array bad{"test"sv, "--int"sv, "x"sv, "--double"sv};
+        options::parse(bad, [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 2);
+        CHECK(errors[0].kind == error_kind::invalid_number);
+        CHECK(errors[0].argument_index == 2);
+        CHECK(errors[1].kind == error_kind::missing_argument);
+        CHECK(errors[1].argument_index == 3);
+    }
+
+    SECTION("Arguments can be generated lazily") {
+        static constexpr std::array words{"test"sv, "--int"sv, "7"sv, "a"sv, "b"sv};
+        auto generated = std::views::iota(std::size_t{}, words.size()) | std::views::transform([](std::size_t i) { return words[i]; });
+        auto lazy = options::parse(generated, error_handler);
+        CHECK(*lazy.get<"--int">() == 7);
+        CHECK(lazy.get<"args">().size() == 2);
+
+        // Ranges of temporary strings would leave dangling string_views behind.
+        auto strings = std::views::iota(0, 3) | std::views::transform([](int i) { return std::to_string(i); });
+        STATIC_REQUIRE(not detail::argument_range<decltype(strings)>);
+    }
+
+    SECTION("A parser can be reused") {
+        options::parser parser{error_handler};
+        for (int i = 0; i < 3; i++) {
+            auto& reused = parser.parse(args);
+            CHECK(*reused.get<"--int">() == 42);
+            CHECK(reused.get<"args">().size() == 1);
+        }
+    }
+}
+
+TEST_CASE("Options can be parsed from a single command line") {
+    using options = clopts<
+        option<"--int", "An integer", int64_t>,
+        option<"--name", "A name", std::string_view>,
+        option<"--file", "A file", file<>>,
+        multiple<positional<"args", "Arguments", std::string_view, false>>,
+        stop_parsing<>>;
+
+    auto path = std::string{__FILE__};
+    auto command_line = "test --int 42 --name 'a b' --file \"" + path + "\" x\\ y \"\" -- z w";
+    auto opts = options::parse_command_line(command_line, error_handler);
+    CHECK(*opts.get<"--int">() == 42);
+    CHECK(*opts.get<"--name">() == "a b");
+    CHECK(opts.get<"--file">()->contents == this_file().second);
+    REQUIRE(opts.get<"args">().size() == 2);
+    CHECK(opts.get<"args">()[0] == "x y");
+    CHECK(opts.get<"args">()[1] == "");
+    REQUIRE(opts.unprocessed().size() == 2);
+    CHECK(opts.unprocessed()[0] == "z"sv);
+    CHECK(opts.unprocessed()[1] == "w"sv);
+
+    SECTION("The option values own the arguments") {
+        command_line.assign(command_line.size(), '?');
+        auto copy = opts;
+        opts = {};
+        CHECK(*copy.get<"--name">() == "a b");
+        CHECK(copy.unprocessed()[1] == "w"sv);
+    }
+
+    SECTION("Command lines that contain NUL bytes are split at those") {
+        auto nul = options::parse_command_line("test\0--name\0'a b'\0\0\\\0"sv, error_handler);
+        CHECK(*nul.get<"--name">() == "'a b'");
+        REQUIRE(nul.get<"args">().size() == 2);
+        CHECK(nul.get<"args">()[0] == "");
+        CHECK(nul.get<"args">()[1] == "\\");
+    }
+
+    SECTION("Errors refer to the index of the argument") {
+        std::vector<parse_error> errors;
+        options::parse_command_line("test  a  --int x", [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].kind == error_kind::invalid_number);
+        CHECK(errors[0].argument_index == 3);
+    }
+
+    SECTION("A parser can be reused") {
+        options::parser parser{error_handler};
+        auto& first = parser.parse_command_line("test --name abc a b c d e f g");
+        auto* buffer = first.get<"--name">()->data();
+        for (auto line : {"test --name xyz", "test --name 'x' a b", ""}) {
+            auto& reused = parser.parse_command_line(line);
+            if (*line) CHECK(reused.get<"--name">()->data() == buffer);
+            else CHECK(not reused.get<"--name">());
+        }
+    }
+}
+
 TEST_CASE("Parser does not crash on invalid input") {
     std::array<const char*, 0> args1 = {};
     std::array args2 = { "test" };
@@ -603,6 +2279,52 @@ TEST_CASE("Overridable options work") {
     CHECK(*opts2.get<"-x">() == "c");
 }
 
+TEST_CASE("defer_overrides only converts the last occurrence") {
+    using options = clopts<
+        overridable<"--file", "A file", file<>>,
+        overridable<"--int", "An integer", int64_t>,
+        overridable<"--type", "Referenced by --tagged", int64_t>,
+        multiple<option<"--tagged", "Tagged", ref<std::string, "--type">>>,
+        defer_overrides>;
+
+    std::array args = {
+        "test",
+        "--file", "/this/file/does/not/exist",
+        "--file", __FILE__,
+        "--int", "not a number",
+        "--int=42",
+        "--type", "1",
+        "--tagged", "a",
+        "--type", "2",
+        "--tagged", "b",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    REQUIRE(opts.get<"--file">());
+    CHECK(opts.get<"--file">()->contents == this_file().second);
+    CHECK(*opts.get<"--int">() == 42);
+    CHECK(*opts.get<"--type">() == 2);
+
+    // Referenced options are still converted every time.
+    auto tagged = opts.get<"--tagged">();
+    REQUIRE(tagged.size() == 2);
+    CHECK(std::get<1>(tagged[0]) == 1);
+    CHECK(std::get<1>(tagged[1]) == 2);
+
+    SECTION("Errors refer to the last occurrence") {
+        std::array bad = {"test", "--int", "1", "--int", "x", "--file", __FILE__};
+        std::vector<parse_error> errors;
+        options::parse(bad.size(), bad.data(), [&](const parse_error& e) {
+            errors.push_back(e);
+            return true;
+        });
+
+        REQUIRE(errors.size() == 1);
+        CHECK(errors[0].kind == error_kind::invalid_number);
+        CHECK(errors[0].argument_index == 4);
+    }
+}
+
 TEST_CASE("Options can reference other options") {
     using options = clopts<
         overridable<"-x", "type">,
@@ -715,6 +2437,69 @@ TEST_CASE("multiple ref<> referencing a multiple<> option.") {
     CHECK((all[2] == tuple{"c", vector{"foo", "bar"}}));
 }
 
+TEST_CASE("snapshot_ref<> records how much of the referenced options was parsed") {
+    using options = clopts<
+        multiple<option<"-v", "value">>,
+        flag<"-f", "flag">,
+        option<"-s", "string">,
+        overridable<"-o", "overridable", int64_t>,
+        multiple<option<"--all", "value", snapshot_ref<std::string, "-v", "-f", "-s", "-o">>>,
+        option<"--one", "value", snapshot_ref<int64_t, "-v">>>;
+
+    std::array args = {
+        "test",
+        "--all", "a",
+        "-v", "foo",
+        "-o", "1",
+        "--all", "b",
+        "-f",
+        "-s", "str",
+        "-v", "bar",
+        "-o", "2",
+        "--all", "c",
+        "--one", "42",
+        "-v", "baz",
+    };
+
+    auto opts = options::parse(args.size(), args.data(), error_handler);
+    auto all = opts.get<"--all">();
+    auto one = opts.get<"--one">();
+
+    REQUIRE(std::ranges::size(all) == 3);
+    auto [a, a_v, a_f, a_s, a_o] = all[0];
+    CHECK(a == "a");
+    CHECK(a_v.empty());
+    CHECK(not a_f);
+    CHECK(a_s == nullptr);
+    CHECK(a_o == nullptr);
+
+    auto [b, b_v, b_f, b_s, b_o] = all[1];
+    CHECK(b == "b");
+    REQUIRE(b_v.size() == 1);
+    CHECK(b_v[0] == "foo");
+    CHECK(not b_f);
+    CHECK(b_s == nullptr);
+    REQUIRE(b_o);
+    CHECK(*b_o == 1);
+
+    auto [c, c_v, c_f, c_s, c_o] = all[2];
+    CHECK(c == "c");
+    REQUIRE(c_v.size() == 2);
+    CHECK(c_v[1] == "bar");
+    CHECK(c_f);
+    REQUIRE(c_s);
+    CHECK(*c_s == "str");
+    REQUIRE(c_o);
+    CHECK(*c_o == 2);
+
+    // The spans point into the storage of the referenced option.
+    CHECK(c_v.data() == opts.get<"-v">().data());
+
+    REQUIRE(one);
+    CHECK(std::get<0>(*one) == 42);
+    CHECK(std::get<1>(*one).size() == 2);
+}
+
 
 TEST_CASE("ref<> referencing a multiple<> option.") {
     using options = clopts<